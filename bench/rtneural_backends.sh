@@ -0,0 +1,37 @@
+#!/bin/sh
+# Copyright 2026 Victor Zappi, Gautham Srinivasan
+# SPDX-License-Identifier: BSD-3-Clause-Clear
+#
+# Builds rtneural_bench once per RTNeural backend (Eigen, xsimd, STL), each in
+# its own build dir, and runs them on the same model and period, so the fastest
+# backend for a project and target can be picked with -DRTNEURAL_BACKEND.
+#
+# usage (from the audio engine root, on the target or with the SDK environment
+# sourced for cross builds; run the binaries on the board then):
+#   bench/rtneural_backends.sh <project path> [rtneural_bench options...]
+# e.g.
+#   bench/rtneural_backends.sh projects/rtneural_osc --period 256
+#
+# Extra cmake arguments (e.g. the toolchain file) can be passed in CMAKE_ARGS.
+
+set -e
+
+if [ $# -lt 1 ]; then
+    echo "usage: $0 <project path> [rtneural_bench options...]" >&2
+    exit 1
+fi
+PROJECT=$1
+shift
+
+for BACKEND in EIGEN XSIMD STL; do
+    BUILD_DIR=build_bench_$(echo "$BACKEND" | tr 'A-Z' 'a-z')
+    cmake -B "$BUILD_DIR" -DPROJECT_PATH="$PROJECT" -DRTNEURAL_BENCH=ON \
+          -DRTNEURAL_BACKEND="$BACKEND" $CMAKE_ARGS > "$BUILD_DIR.log" 2>&1 &&
+    cmake --build "$BUILD_DIR" --target rtneural_bench -j >> "$BUILD_DIR.log" 2>&1 ||
+        { echo "$BACKEND: build failed, see $BUILD_DIR.log" >&2; continue; }
+done
+
+for BACKEND in EIGEN XSIMD STL; do
+    BENCH=build_bench_$(echo "$BACKEND" | tr 'A-Z' 'a-z')/rtneural_bench
+    if [ -x "$BENCH" ]; then "$BENCH" "$@"; fi
+done
@@ -0,0 +1,583 @@
+/*
+ * Copyright 2026 Victor Zappi, Gautham Srinivasan
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+// rtneural_bench: times an RTNeural model on a plain host or on the board, with
+// the RTNeural backend this build was configured with (RTNEURAL_BACKEND), and
+// reports ns/sample against the real-time budget at the given period size. Run
+// bench/rtneural_backends.sh to build and run it once per backend.
+//
+// The model is either an RTNeural JSON model (with "layers", run per sample with
+// forward()) or, as in projects/rtneural_osc, a PyTorch state dict of a dense
+// network (<layer>.weight / <layer>.bias pairs, one activation between them),
+// which is run both per sample with forward() and per block with RTNeuralBlock's
+// BlockModel. The layers of a state dict are given in order with --layers,
+// taken in the order of the embedded model (below) when it is that model, and
+// chained by size otherwise.
+//
+// Those are RTNeural's run-time Model<float>. A project's compile-time ModelT
+// runs different code on every backend, so when the build embeds the project's
+// model (model_weights.h, BENCH_MODEL_WEIGHTS) that network is also timed as a
+// ModelT.
+
+#include <RTNeural/RTNeural.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <ctype.h>
+#include <fstream>
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "RTNeuralBlock.h"
+#ifdef BENCH_MODEL_WEIGHTS
+#include "model_weights.h"
+#endif
+
+#define OPTPARSE_IMPLEMENTATION
+#include "optparse.h"
+
+#ifndef BENCH_DEFAULT_MODEL
+#define BENCH_DEFAULT_MODEL ""
+#endif
+
+struct bench_options
+{
+    std::string modelPath = BENCH_DEFAULT_MODEL;
+    unsigned int periodSize = 960; // the engine's default period
+    unsigned int sampleRate = 48000;
+    float seconds = 2.f;           // of timed processing per measurement
+    ar::rtneural::Activation activation = ar::rtneural::Activation::ReLu;
+    std::vector<std::string> layers; // state dict layer prefixes, in order; empty: embedded order or chain by size
+};
+
+static void showHelp()
+{
+    fprintf(stderr, "\nrtneural_bench (%s backend) options:\n", BENCH_BACKEND);
+    fprintf(stderr, "  --model <json>        RTNeural JSON model or PyTorch dense state dict\n");
+    fprintf(stderr, "                        (default: %s)\n", strlen(BENCH_DEFAULT_MODEL) ? BENCH_DEFAULT_MODEL : "none");
+    fprintf(stderr, "  --period <frames>     Period size (default 960)\n");
+    fprintf(stderr, "  --rate <hz>           Sample rate, for the real-time budget (default 48000)\n");
+    fprintf(stderr, "  --seconds <s>         Timed processing per measurement (default 2)\n");
+    fprintf(stderr, "  --activation <name>   State dicts: relu, tanh or sigmoid between layers (default relu)\n");
+    fprintf(stderr, "  --layers <p1,p2,...>  State dicts: layer prefixes in network order, e.g. fc1.,fc2.\n");
+    fprintf(stderr, "                        (default: the embedded model's order, or chained by size)\n");
+    fprintf(stderr, "  --bench-help          Show this help message\n\n");
+}
+
+static bool parseOptions(char **argv, bench_options &options)
+{
+    enum
+    {
+        OPT_MODEL = 256,
+        OPT_PERIOD,
+        OPT_RATE,
+        OPT_SECONDS,
+        OPT_ACTIVATION,
+        OPT_LAYERS,
+        OPT_HELP,
+    };
+    struct optparse opts;
+    struct optparse_long long_options[] = {
+        {"model", OPT_MODEL, OPTPARSE_REQUIRED},
+        {"period", OPT_PERIOD, OPTPARSE_REQUIRED},
+        {"rate", OPT_RATE, OPTPARSE_REQUIRED},
+        {"seconds", OPT_SECONDS, OPTPARSE_REQUIRED},
+        {"activation", OPT_ACTIVATION, OPTPARSE_REQUIRED},
+        {"layers", OPT_LAYERS, OPTPARSE_REQUIRED},
+        {"bench-help", OPT_HELP, OPTPARSE_NONE},
+        {0, 0, OPTPARSE_NONE}};
+
+    int c;
+    optparse_init(&opts, argv);
+    while ((c = optparse_long(&opts, long_options, NULL)) != -1)
+    {
+        switch (c)
+        {
+        case OPT_MODEL:
+            options.modelPath = opts.optarg;
+            break;
+        case OPT_PERIOD:
+            if (sscanf(opts.optarg, "%u", &options.periodSize) != 1 || options.periodSize == 0)
+            {
+                fprintf(stderr, "invalid period size '%s'\n", opts.optarg);
+                return false;
+            }
+            break;
+        case OPT_RATE:
+            if (sscanf(opts.optarg, "%u", &options.sampleRate) != 1 || options.sampleRate == 0)
+            {
+                fprintf(stderr, "invalid sample rate '%s'\n", opts.optarg);
+                return false;
+            }
+            break;
+        case OPT_SECONDS:
+            if (sscanf(opts.optarg, "%f", &options.seconds) != 1 || options.seconds <= 0.f)
+            {
+                fprintf(stderr, "invalid duration '%s'\n", opts.optarg);
+                return false;
+            }
+            break;
+        case OPT_ACTIVATION:
+            if (strcmp(opts.optarg, "relu") == 0)
+                options.activation = ar::rtneural::Activation::ReLu;
+            else if (strcmp(opts.optarg, "tanh") == 0)
+                options.activation = ar::rtneural::Activation::Tanh;
+            else if (strcmp(opts.optarg, "sigmoid") == 0)
+                options.activation = ar::rtneural::Activation::Sigmoid;
+            else
+            {
+                fprintf(stderr, "invalid activation '%s' (must be relu, tanh or sigmoid)\n", opts.optarg);
+                return false;
+            }
+            break;
+        case OPT_LAYERS:
+        {
+            options.layers.clear();
+            std::string list = opts.optarg;
+            size_t start = 0;
+            for (;;)
+            {
+                size_t end = list.find(',', start);
+                std::string prefix = list.substr(start, end == std::string::npos ? std::string::npos : end - start);
+                if (!prefix.empty())
+                    options.layers.push_back(prefix);
+                if (end == std::string::npos)
+                    break;
+                start = end + 1;
+            }
+            if (options.layers.empty())
+            {
+                fprintf(stderr, "invalid layer list '%s'\n", opts.optarg);
+                return false;
+            }
+            break;
+        }
+        case OPT_HELP:
+            showHelp();
+            exit(EXIT_SUCCESS);
+        case '?':
+            fprintf(stderr, "%s\n", opts.errmsg);
+            showHelp();
+            return false;
+        }
+    }
+    if (options.modelPath.empty())
+    {
+        fprintf(stderr, "no model: pass --model <json> (or configure with a PROJECT_PATH that ships one)\n");
+        return false;
+    }
+    return true;
+}
+
+// dense layers of a PyTorch state dict: <prefix>weight [out][in] + <prefix>bias [out]
+struct DenseWeights
+{
+    std::string prefix;
+    std::vector<std::vector<float>> weights;
+    std::vector<float> bias;
+};
+
+// names with their numbers compared by value, so that fc2. comes before fc10.
+static bool naturalLess(const std::string &a, const std::string &b)
+{
+    size_t i = 0, j = 0;
+    while (i < a.size() && j < b.size())
+    {
+        if (isdigit((unsigned char)a[i]) && isdigit((unsigned char)b[j]))
+        {
+            size_t iEnd = i, jEnd = j;
+            while (iEnd < a.size() && isdigit((unsigned char)a[iEnd]))
+                ++iEnd;
+            while (jEnd < b.size() && isdigit((unsigned char)b[jEnd]))
+                ++jEnd;
+            unsigned long long x = strtoull(a.c_str() + i, nullptr, 10);
+            unsigned long long y = strtoull(b.c_str() + j, nullptr, 10);
+            if (x != y)
+                return x < y;
+            i = iEnd;
+            j = jEnd;
+        }
+        else
+        {
+            if (a[i] != b[j])
+                return a[i] < b[j];
+            ++i;
+            ++j;
+        }
+    }
+    return a.size() - i < b.size() - j;
+}
+
+static bool readDense(const nlohmann::json &modelJson, const std::string &prefix, DenseWeights &layer)
+{
+    if (!modelJson.contains(prefix + "weight") || !modelJson.contains(prefix + "bias"))
+    {
+        fprintf(stderr, "no layer '%s' (%sweight / %sbias) in the state dict\n", prefix.c_str(), prefix.c_str(), prefix.c_str());
+        return false;
+    }
+    layer.prefix = prefix;
+    layer.weights = modelJson.at(prefix + "weight").get<std::vector<std::vector<float>>>();
+    layer.bias = modelJson.at(prefix + "bias").get<std::vector<float>>();
+    if (layer.weights.empty() || layer.weights.size() != layer.bias.size())
+    {
+        fprintf(stderr, "layer '%s': weight/bias sizes don't match\n", prefix.c_str());
+        return false;
+    }
+    return true;
+}
+
+// The dense layers of a state dict, in network order: the order of prefixes if
+// given, otherwise chained by size with the rule of embed_weights.cmake (see
+// there), for the models it hasn't ordered at build time
+static bool readStateDict(const nlohmann::json &modelJson, const std::vector<std::string> &prefixes,
+                          std::vector<DenseWeights> &layers)
+{
+    if (!prefixes.empty())
+    {
+        for (const std::string &prefix : prefixes)
+        {
+            DenseWeights layer;
+            if (!readDense(modelJson, prefix, layer))
+                return false;
+            layers.push_back(layer);
+        }
+    }
+    else
+    {
+        const std::string suffix = "weight";
+        std::vector<DenseWeights> found;
+        for (auto it = modelJson.begin(); it != modelJson.end(); ++it)
+        {
+            const std::string &key = it.key();
+            if (key.size() < suffix.size() || key.compare(key.size() - suffix.size(), suffix.size(), suffix) != 0)
+                continue;
+            const std::string prefix = key.substr(0, key.size() - suffix.size());
+            if (!modelJson.contains(prefix + "bias"))
+                continue;
+            DenseWeights layer;
+            if (!readDense(modelJson, prefix, layer))
+                return false;
+            found.push_back(layer);
+        }
+        if (found.empty())
+            return false;
+        std::sort(found.begin(), found.end(), [](const DenseWeights &a, const DenseWeights &b)
+                  { return naturalLess(a.prefix, b.prefix); });
+
+        size_t first = 0;
+        for (size_t l = 0; l < found.size(); ++l)
+        {
+            bool fed = false;
+            for (size_t k = 0; k < found.size(); ++k)
+                fed |= k != l && found[k].weights.size() == found[l].weights[0].size();
+            if (!fed)
+            {
+                first = l;
+                break;
+            }
+        }
+        layers.push_back(found[first]);
+        found.erase(found.begin() + first);
+        while (!found.empty())
+        {
+            auto next = std::find_if(found.begin(), found.end(), [&](const DenseWeights &layer)
+                                     { return layer.weights[0].size() == layers.back().weights.size(); });
+            if (next == found.end())
+            {
+                fprintf(stderr, "can't chain layer '%s' after '%s': pass the order with --layers\n",
+                        found[0].prefix.c_str(), layers.back().prefix.c_str());
+                return false;
+            }
+            layers.push_back(*next);
+            found.erase(next);
+        }
+    }
+
+    for (size_t l = 1; l < layers.size(); ++l)
+    {
+        if (layers[l - 1].weights.size() != layers[l].weights[0].size())
+        {
+            fprintf(stderr, "layer '%s' doesn't take the previous layer's output\n", layers[l].prefix.c_str());
+            return false;
+        }
+    }
+    return !layers.empty();
+}
+
+static RTNeural::Layer<float> *makeActivation(ar::rtneural::Activation activation, int size)
+{
+    switch (activation)
+    {
+    case ar::rtneural::Activation::Tanh:    return new RTNeural::TanhActivation<float>(size);
+    case ar::rtneural::Activation::Sigmoid: return new RTNeural::SigmoidActivation<float>(size);
+    default:                                return new RTNeural::ReLuActivation<float>(size);
+    }
+}
+
+// runs process(period) for options.seconds, returns ns per sample
+template <typename Process>
+static double timePerSample(const bench_options &options, Process &&process)
+{
+    // warm-up: caches, branch predictors, lazy allocations
+    for (int k = 0; k < 10; ++k)
+        process();
+
+    using clock = std::chrono::steady_clock;
+    size_t periods = 0;
+    auto t0 = clock::now();
+    auto end = t0 + std::chrono::duration<float>(options.seconds);
+    auto t1 = t0;
+    do
+    {
+        for (int k = 0; k < 10; ++k)
+            process();
+        periods += 10;
+        t1 = clock::now();
+    } while (t1 < end);
+    return std::chrono::duration<double, std::nano>(t1 - t0).count() / ((double)periods * options.periodSize);
+}
+
+static void report(const bench_options &options, const char *what, double nsPerSample)
+{
+    const double budgetNs = 1e9 / options.sampleRate;
+    printf("%-8s %-22s %10.1f ns/sample  %6.1f%% of the real-time budget\n",
+           BENCH_BACKEND, what, nsPerSample, 100.0 * nsPerSample / budgetNs);
+}
+
+#ifdef BENCH_MODEL_WEIGHTS
+// The layer order model_weights.h was generated with, if the state dict has the
+// embedded layers and no others (the project's model); empty otherwise
+static std::vector<std::string> embeddedOrder(const nlohmann::json &modelJson)
+{
+    std::vector<std::string> prefixes;
+    size_t pairs = 0;
+    for (auto it = modelJson.begin(); it != modelJson.end(); ++it)
+    {
+        const std::string &key = it.key();
+        const std::string suffix = "weight";
+        if (key.size() >= suffix.size() && key.compare(key.size() - suffix.size(), suffix.size(), suffix) == 0 &&
+            modelJson.contains(key.substr(0, key.size() - suffix.size()) + "bias"))
+            ++pairs;
+    }
+    if (pairs != (size_t)model_weights::numLayers)
+        return prefixes;
+    for (const model_weights::DenseLayer &layer : model_weights::layers)
+    {
+        if (!modelJson.contains(std::string(layer.name) + "weight"))
+            return std::vector<std::string>();
+        prefixes.push_back(layer.name);
+    }
+    return prefixes;
+}
+
+// The project's network (model_weights.h) as a compile-time RTNeural::ModelT:
+// DenseT, activation, DenseT, ..., DenseT, with the sizes of the embedded layers
+namespace modelt
+{
+    using model_weights::layers;
+    using model_weights::numLayers;
+
+    struct ReLu    { template <int N> using type = RTNeural::ReLuActivationT<float, N>; };
+    struct Tanh    { template <int N> using type = RTNeural::TanhActivationT<float, N>; };
+    struct Sigmoid { template <int N> using type = RTNeural::SigmoidActivationT<float, N>; };
+
+    template <size_t I>
+    using Dense = RTNeural::DenseT<float, layers[I].inSize, layers[I].outSize>;
+
+    template <typename Act, size_t I, bool Last = I + 1 == (size_t)numLayers>
+    struct Stage
+    {
+        using type = std::tuple<Dense<I>, typename Act::template type<layers[I].outSize>>;
+    };
+    template <typename Act, size_t I>
+    struct Stage<Act, I, true>
+    {
+        using type = std::tuple<Dense<I>>;
+    };
+
+    template <typename Layers>
+    struct ToModel;
+    template <typename... L>
+    struct ToModel<std::tuple<L...>>
+    {
+        using type = RTNeural::ModelT<float, layers[0].inSize, layers[numLayers - 1].outSize, L...>;
+    };
+
+    template <typename Act, typename Indices>
+    struct Build;
+    template <typename Act, size_t... I>
+    struct Build<Act, std::index_sequence<I...>>
+    {
+        using type = typename ToModel<decltype(std::tuple_cat(std::declval<typename Stage<Act, I>::type>()...))>::type;
+    };
+
+    template <typename Act>
+    using Model = typename Build<Act, std::make_index_sequence<numLayers>>::type;
+
+    // dense layer I is layer 2 * I of the model, after I activations
+    template <size_t I, typename M>
+    void setDense(M &model)
+    {
+        std::vector<std::vector<float>> weights(layers[I].outSize, std::vector<float>(layers[I].inSize));
+        for (int o = 0; o < layers[I].outSize; ++o)
+            for (int i = 0; i < layers[I].inSize; ++i)
+                weights[o][i] = layers[I].weights[o * layers[I].inSize + i];
+        model.template get<2 * I>().setWeights(weights);
+        model.template get<2 * I>().setBias(layers[I].bias);
+    }
+
+    template <typename M, size_t... I>
+    void setWeights(M &model, std::index_sequence<I...>)
+    {
+        (setDense<I>(model), ...);
+    }
+} // namespace modelt
+
+template <typename Act>
+static void timeModelT(const bench_options &options)
+{
+    using Model = modelt::Model<Act>;
+    std::unique_ptr<Model> model(new Model());
+    modelt::setWeights(*model, std::make_index_sequence<model_weights::numLayers>());
+    model->reset();
+
+    const int inSize = model_weights::layers[0].inSize;
+    printf("ModelT: the project's embedded model (%d layers, %d in, %d out)\n",
+           model_weights::numLayers, inSize, model_weights::layers[model_weights::numLayers - 1].outSize);
+    std::vector<float> input((size_t)options.periodSize * inSize);
+    for (size_t n = 0; n < options.periodSize; ++n)
+        for (int i = 0; i < inSize; ++i)
+            input[n * inSize + i] = (float)(2.0 * M_PI * (double)n / options.periodSize);
+
+    volatile float sink = 0.f;
+    report(options, "ModelT forward()", timePerSample(options, [&]
+    {
+        for (size_t n = 0; n < options.periodSize; ++n)
+            sink = model->forward(&input[n * inSize]);
+    }));
+    (void)sink;
+}
+#endif
+
+int main(int argc, char *argv[])
+{
+    (void)argc;
+    bench_options options;
+    if (!parseOptions(argv, options))
+        return EXIT_FAILURE;
+
+    std::ifstream jsonStream(options.modelPath, std::ifstream::binary);
+    if (!jsonStream)
+    {
+        fprintf(stderr, "can't open model '%s'\n", options.modelPath.c_str());
+        return EXIT_FAILURE;
+    }
+    nlohmann::json modelJson;
+    try
+    {
+        jsonStream >> modelJson;
+    }
+    catch (const std::exception &e)
+    {
+        fprintf(stderr, "can't parse model '%s': %s\n", options.modelPath.c_str(), e.what());
+        return EXIT_FAILURE;
+    }
+
+    // build the per-sample model, and the block model when the format allows it
+    std::unique_ptr<RTNeural::Model<float>> model;
+    std::unique_ptr<ar::rtneural::BlockModel<float>> blockModel;
+    if (modelJson.contains("layers"))
+        model = RTNeural::json_parser::parseJson<float>(modelJson);
+    else
+    {
+        std::vector<std::string> order = options.layers;
+#ifdef BENCH_MODEL_WEIGHTS
+        if (order.empty())
+            order = embeddedOrder(modelJson);
+#endif
+        std::vector<DenseWeights> layers;
+        if (!readStateDict(modelJson, order, layers))
+        {
+            fprintf(stderr, "'%s' is neither an RTNeural model nor a usable dense state dict\n", options.modelPath.c_str());
+            return EXIT_FAILURE;
+        }
+        printf("layers:");
+        for (const DenseWeights &layer : layers)
+            printf(" %s (%zu -> %zu)", layer.prefix.c_str(), layer.weights[0].size(), layer.weights.size());
+        printf("\n");
+        model.reset(new RTNeural::Model<float>((int)layers[0].weights[0].size()));
+        blockModel.reset(new ar::rtneural::BlockModel<float>());
+        for (size_t l = 0; l < layers.size(); ++l)
+        {
+            const int inSize = (int)layers[l].weights[0].size();
+            const int outSize = (int)layers[l].weights.size();
+            const bool last = l + 1 == layers.size();
+
+            auto *dense = new RTNeural::Dense<float>(inSize, outSize);
+            dense->setWeights(layers[l].weights);
+            dense->setBias(layers[l].bias.data());
+            model->addLayer(dense);
+            if (!last)
+                model->addLayer(makeActivation(options.activation, outSize));
+
+            blockModel->addDense(inSize, outSize, last ? ar::rtneural::Activation::None : options.activation);
+            if (!blockModel->loadDense(modelJson, l, layers[l].prefix))
+            {
+                fprintf(stderr, "BlockModel: failed to load layer '%s'\n", layers[l].prefix.c_str());
+                return EXIT_FAILURE;
+            }
+        }
+        blockModel->prepare((int)options.periodSize);
+    }
+    if (!model)
+    {
+        fprintf(stderr, "failed to build the model from '%s'\n", options.modelPath.c_str());
+        return EXIT_FAILURE;
+    }
+    model->reset();
+
+    const int inSize = model->getInSize();
+    const int outSize = model->getOutSize();
+    printf("rtneural_bench: %s backend, model %s (%d in, %d out), period %u, %u Hz\n",
+           BENCH_BACKEND, options.modelPath.c_str(), inSize, outSize, options.periodSize, options.sampleRate);
+
+    // a slow ramp on every input, like a phase: any finite input will do
+    std::vector<float> input((size_t)options.periodSize * inSize), output((size_t)options.periodSize * outSize);
+    for (size_t n = 0; n < options.periodSize; ++n)
+        for (int i = 0; i < inSize; ++i)
+            input[n * inSize + i] = (float)(2.0 * M_PI * (double)n / options.periodSize);
+
+    volatile float sink = 0.f;
+    report(options, "forward() per sample", timePerSample(options, [&]
+    {
+        for (size_t n = 0; n < options.periodSize; ++n)
+            sink = model->forward(&input[n * inSize]);
+    }));
+    if (blockModel)
+    {
+        report(options, "block (RTNeuralBlock)", timePerSample(options, [&]
+        {
+            blockModel->process(input.data(), output.data(), (int)options.periodSize);
+            sink = output[0];
+        }));
+    }
+    (void)sink;
+#ifdef BENCH_MODEL_WEIGHTS
+    switch (options.activation)
+    {
+    case ar::rtneural::Activation::Tanh:    timeModelT<modelt::Tanh>(options); break;
+    case ar::rtneural::Activation::Sigmoid: timeModelT<modelt::Sigmoid>(options); break;
+    default:                                timeModelT<modelt::ReLu>(options); break;
+    }
+#endif
+    return EXIT_SUCCESS;
+}
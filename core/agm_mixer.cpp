@@ -41,6 +41,9 @@
 #include <stdint.h>
 #include <string.h>
 #include <signal.h>
+#include <pthread.h>
+
+#include <unordered_map>
 
 #include <agm/agm_api.h>
 #include "pcm_utils.h"
@@ -77,12 +80,22 @@ struct group_config {
 };
 //-------------------------------
 
+// module behind a graph tag, as reported by getTaggedInfo
+struct agm_module_info {
+    uint32_t mid;   // module id
+    uint32_t miid;  // module instance id
+};
+
 // front/back endpoint info for one direction (not the graph itself); the engine
 // keeps one entry per active direction so playback and capture can coexist
 struct agm_endpoints {
     char *frontend_name;
     char *backend_name;
     struct device_config backend_config;
+    // tag -> first module carrying it, decoded from a single getTaggedInfo read at
+    // graph setup (load_agm_module_tables); dropped on cleanup
+    std::unordered_map<uint32_t, struct agm_module_info> tag_modules;
+    bool tag_modules_loaded;
 };
 #define AGM_MAX_ENDPOINTS 2
 
@@ -90,6 +103,34 @@ static struct mixer *g_mixer = NULL;
 static struct agm_endpoints g_endpoints[AGM_MAX_ENDPOINTS];
 static int g_num_endpoints = 0;
 
+// one thread at a time on the virtual card's mixer: at runtime the param service
+// thread writes params while the audio thread may switch the echo reference.
+// Recursive, because the multi-control operations (metadata + read, query + read)
+// hold it around the single-control helpers; priority inheritance, so the audio
+// thread never waits behind a preempted normal-priority holder
+static pthread_mutex_t g_mixer_lock;
+static pthread_once_t g_mixer_lock_once = PTHREAD_ONCE_INIT;
+
+static void init_mixer_lock(void)
+{
+    pthread_mutexattr_t attr;
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
+    pthread_mutex_init(&g_mixer_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+struct mixer_lock_guard {
+    mixer_lock_guard()
+    {
+        pthread_once(&g_mixer_lock_once, init_mixer_lock);
+        pthread_mutex_lock(&g_mixer_lock);
+    }
+    ~mixer_lock_guard() { pthread_mutex_unlock(&g_mixer_lock); }
+};
+
 
 enum {
     DEVICE = 1,
@@ -219,6 +260,7 @@ static void print_metadata_info(const char *mixer_str,
 static int get_mixer_ctl_array(const char *mixer_str,
                                 void *payload, size_t payload_size)
 {
+    struct mixer_lock_guard lock;
     struct mixer_ctl *ctl;
     int ret = 0;
 
@@ -241,6 +283,7 @@ static int get_mixer_ctl_array(const char *mixer_str,
 int get_mixer_ctl_string(const char *mixer_str,
                          char *payload, size_t payload_size)
 {
+    struct mixer_lock_guard lock;
     struct mixer_ctl *ctl;
     unsigned int value;
     const char *enum_str;
@@ -270,6 +313,7 @@ int get_mixer_ctl_string(const char *mixer_str,
 static int set_mixer_ctl_array(const char *mixer_str,
                               const void *payload, size_t payload_size)
 {
+    struct mixer_lock_guard lock;
     struct mixer_ctl *ctl;
     int ret = 0;
 
@@ -292,6 +336,7 @@ static int set_mixer_ctl_array(const char *mixer_str,
 int set_mixer_ctl_string(const char *mixer_str,
                             const char *payload)
 {
+    struct mixer_lock_guard lock;
     struct mixer_ctl *ctl;
     int ret = 0;
 
@@ -814,92 +859,195 @@ int set_agm_backend_config(char *backend_name, struct device_config *config)
     return ret;
 }
 
-int get_agm_module_iid(char *frontend_name, char *backend_name, int tag_id,
-                       uint32_t *miid, uint32_t *mid)
+// find the endpoint pair a graph was set up with; backend_name may be NULL to
+// match on the frontend alone
+static struct agm_endpoints *find_agm_endpoints(const char *frontend_name, const char *backend_name)
 {
-    printf("---get_agm_module_iid, searching for tag 0x%X (%s)\n", tag_id, get_tag_name(tag_id));
+    for (int d = 0; d < g_num_endpoints; d++) {
+        if (strcmp(g_endpoints[d].frontend_name, frontend_name) != 0)
+            continue;
+        if (backend_name && strcmp(g_endpoints[d].backend_name, backend_name) != 0)
+            continue;
+        return &g_endpoints[d];
+    }
+    return NULL;
+}
+
+// read the whole tag/module table of a connected graph with one getTaggedInfo
+// round trip and cache it in the endpoint, so later lookups don't go back through
+// the AGM plugin. The read is exactly the control's advertised size: tinyalsa
+// rejects anything larger, so a table that doesn't fit in it is an error.
+static int load_agm_tagged_info(struct agm_endpoints *ep)
+{
+    printf("---load_agm_tagged_info\n");
 
+    // the metadata write and the read must not interleave with another thread's
+    struct mixer_lock_guard lock;
     char *control = (char *)"getTaggedInfo";
     char *mixer_str;
-    int ret = 0, i;
-    void *payload;
-    int payload_size = 1024;
+    struct mixer_ctl *ctl;
+    uint8_t *payload = NULL;
+    size_t payload_size;
     struct gsl_tag_module_info *tag_info;
     struct gsl_tag_module_info_entry *tag_entry;
-    char *tag_entry_ptr;
-    char *type = backend_name;
+    uint8_t *tag_entry_ptr;
+    uint8_t *payload_end;
+    int ret = 0;
 
-    ret = set_agm_stream_metadata_type(frontend_name, type);
+    ret = set_agm_stream_metadata_type(ep->frontend_name, ep->backend_name);
     if (ret)
         return ret;
 
     // Construct mixer control string
-    mixer_str = build_mixer_control_string(frontend_name, control);
+    mixer_str = build_mixer_control_string(ep->frontend_name, control);
     if (!mixer_str) {
         return -ENOMEM;
     }
 
+    ctl = mixer_get_ctl_by_name(g_mixer, mixer_str);
+    if (!ctl) {
+        printf("Could not find mixer ctl: %s\n", mixer_str);
+        free(mixer_str);
+        return -ENODEV;
+    }
+    payload_size = mixer_ctl_get_num_values(ctl);
+    if (payload_size < sizeof(struct gsl_tag_module_info)) {
+        printf("---\t%s: control too small (%zu bytes)\n", mixer_str, payload_size);
+        ret = -EINVAL;
+        goto done;
+    }
+
+    ep->tag_modules.clear();
+
     // Prepare container for ctl array
-    payload = calloc(payload_size, sizeof(char));
+    payload = (uint8_t *)calloc(payload_size, sizeof(uint8_t));
     if (!payload) {
-        free(mixer_str);
-        return -ENOMEM;
+        ret = -ENOMEM;
+        goto done;
     }
 
     // Get the ctl array using helper function
     ret = get_mixer_ctl_array(mixer_str, payload, payload_size);
-    if (ret < 0) {
-        free(payload);
-        free(mixer_str);
-        return ret;
+    if (ret < 0)
+        goto done;
+
+    // walk the variable-length entries, never past the end of what was read
+    tag_info = (struct gsl_tag_module_info *)payload;
+    tag_entry_ptr = (uint8_t *)&tag_info->tag_module_entry[0];
+    payload_end = payload + payload_size;
+
+    for (uint32_t i = 0; i < tag_info->num_tags; i++) {
+        tag_entry = (struct gsl_tag_module_info_entry *)tag_entry_ptr;
+        if (tag_entry_ptr + sizeof(struct gsl_tag_module_info_entry) > payload_end ||
+            tag_entry_ptr + sizeof(struct gsl_tag_module_info_entry) +
+                tag_entry->num_modules * sizeof(struct gsl_module_id_info_entry) > payload_end) {
+            printf("---\t%s: table truncated at tag %u of %u (control is %zu bytes)\n", mixer_str, i,
+                   tag_info->num_tags, payload_size);
+            ep->tag_modules.clear();
+            ret = -E2BIG;
+            goto done;
+        }
+        tag_entry_ptr += sizeof(struct gsl_tag_module_info_entry) +
+            tag_entry->num_modules * sizeof(struct gsl_module_id_info_entry);
+
+        // like the per-tag search this replaces, only the first module of a tag is kept
+        if (tag_entry->num_modules && ep->tag_modules.count(tag_entry->tag_id) == 0) {
+            struct agm_module_info info;
+            info.mid = tag_entry->module_entry[0].module_id;
+            info.miid = tag_entry->module_entry[0].module_iid;
+            ep->tag_modules[tag_entry->tag_id] = info;
+        }
     }
 
-    printf("---\t%s\n", mixer_str);
+    printf("---\t%s: %d tags (%zu bytes read)\n", mixer_str, tag_info->num_tags, payload_size);
+    for (auto &entry : ep->tag_modules)
+        printf("---\t\ttag 0x%X (%s) -> mid 0x%X, miid 0x%X\n", entry.first, get_tag_name(entry.first),
+               entry.second.mid, entry.second.miid);
 
-    tag_info = (struct gsl_tag_module_info *)payload;
-    ret = -1;
-    tag_entry_ptr = (char *)&tag_info->tag_module_entry[0]; // cast useful to apply byte offset in between entries
+    ep->tag_modules_loaded = true;
+    ret = 0;
+
+done:
+    free(payload);
+    free(mixer_str);
+    return ret;
+}
 
-    printf("---\tnum_tags: %d\n", tag_info->num_tags);
+int get_agm_module_iid(char *frontend_name, char *backend_name, int tag_id,
+                       uint32_t *miid, uint32_t *mid)
+{
+    printf("---get_agm_module_iid, searching for tag 0x%X (%s)\n", tag_id, get_tag_name(tag_id));
 
-    int found=0;
-    for (i = 0; i < (int)tag_info->num_tags; i++) {
-        tag_entry = (struct gsl_tag_module_info_entry *)tag_entry_ptr; // current tag_entry, variable-length struct 
-        tag_entry_ptr += sizeof(struct gsl_tag_module_info_entry) + 
-           (tag_entry->num_modules * sizeof(struct gsl_module_id_info_entry)); // move poitner to next entry via byte offset
+    struct agm_endpoints *ep;
+    int ret = 0;
 
-        printf("---\t\ttag_entry %d, id: 0x%X (%s)\n", i, tag_entry->tag_id, get_tag_name(tag_entry->tag_id));
-        
-        if(found)
-            continue; // or beak if we don't want to see other modules's iids!
-
-        if (tag_entry->tag_id == (u_int32_t)tag_id) {
-            printf("---\t\t\tfound tag id 0x%X (%s)\n", tag_entry->tag_id, get_tag_name(tag_id));
-            struct gsl_module_id_info_entry *mod_info_entry;
-
-            if (tag_entry->num_modules) {
-                printf("---\t\t\ttag_entry[%d].num_modules: %d\n", i, tag_entry->num_modules);
-                 mod_info_entry = &tag_entry->module_entry[0];
-                 *mid = mod_info_entry->module_id;
-                 *miid = mod_info_entry->module_iid;
-                 printf("---\t\t\ttag_entry[%d].module_entry[0].id: 0x%X\n", i, mod_info_entry->module_id);
-                 printf("---\t\t\ttag_entry[%d].module_entry[0].iid: 0x%X\n", i, mod_info_entry->module_iid);
-                 ret = 0;
-                 found=1;
-            }
-        }
+    ep = find_agm_endpoints(frontend_name, backend_name);
+    if (!ep) {
+        printf("---\tNo graph set up for %s -> %s\n", frontend_name, backend_name);
+        return -ENODEV;
+    }
+
+    // one getTaggedInfo per graph; every later lookup is served from the cache
+    if (!ep->tag_modules_loaded) {
+        ret = load_agm_tagged_info(ep);
+        if (ret)
+            return ret;
     }
 
-    if (found == 0) {
+    auto it = ep->tag_modules.find((uint32_t)tag_id);
+    if (it == ep->tag_modules.end()) {
         printf("---\tCould not find tag 0x%X (%s)\n", tag_id, get_tag_name(tag_id));
-        ret = 1;
+        return 1;
     }
 
-    free(payload);
-    free(mixer_str);
+    *mid = it->second.mid;
+    *miid = it->second.miid;
+    printf("---\t\tfound tag id 0x%X (%s): mid 0x%X, miid 0x%X\n", tag_id, get_tag_name(tag_id),
+           *mid, *miid);
+    return 0;
+}
+
+const char *get_agm_frontend_name(unsigned int graph)
+{
+    if ((int)graph >= g_num_endpoints)
+        return NULL;
+    return g_endpoints[graph].frontend_name;
+}
+
+int load_agm_module_tables(void)
+{
+    struct mixer_lock_guard lock;
+    int ret = 0;
+
+    for (int d = 0; d < g_num_endpoints; d++) {
+        if (g_endpoints[d].tag_modules_loaded)
+            continue;
+        int err = load_agm_tagged_info(&g_endpoints[d]);
+        if (err && ret == 0)
+            ret = err;
+    }
     return ret;
 }
 
+int lookup_agm_module(const char *frontend_name, uint32_t tag_id, uint32_t *miid, uint32_t *mid)
+{
+    struct agm_endpoints *ep = find_agm_endpoints(frontend_name, NULL);
+    if (!ep)
+        return -ENODEV;
+
+    // cache only: no mixer traffic here, the table was read at graph setup
+    if (!ep->tag_modules_loaded)
+        return -ENODATA;
+
+    auto it = ep->tag_modules.find(tag_id);
+    if (it == ep->tag_modules.end())
+        return 1;
+
+    *mid = it->second.mid;
+    *miid = it->second.miid;
+    return 0;
+}
+
 int set_agm_param(char *frontend_name, void *payload, uint32_t size)
 {
     char *control = (char *)"setParam";
@@ -926,6 +1074,8 @@ int set_agm_param(char *frontend_name, void *payload, uint32_t size)
 
 int get_agm_param(char *frontend_name, void *payload, uint32_t size)
 {
+    // query write + reply read, as one transaction
+    struct mixer_lock_guard lock;
     char *control = (char *)"getParam";
     char *mixer_str;
     int ret = 0;
@@ -1091,190 +1241,230 @@ static uint8_t* create_agm_param_payload(size_t param_size,
     return payload;
 }
 
-int configure_agm_mfc(char *frontend_name, unsigned int rate, unsigned int channels,
-                  unsigned int bits, uint32_t miid)
+// Multi-module setParam payload: a sequence of module parameter blocks, each an
+// apm_module_param_data_t header followed by its param data and padded to 8 bytes,
+// submitted with a single setParam write. The buffer is kept across submissions
+// (reset, not freed), so steady-state reconfiguration does not allocate. Not
+// shared across threads: g_param_batch is the setup code's, the param service
+// has its own.
+struct agm_param_batch {
+    uint8_t *buf;
+    size_t size;       // bytes used (always a multiple of 8)
+    size_t capacity;   // bytes allocated
+    unsigned int num_params;
+};
+
+static struct agm_param_batch g_param_batch = { NULL, 0, 0, 0 };
+
+static void agm_param_batch_reset(struct agm_param_batch *batch)
 {
-    printf("---configure_agm_mfc\n");
+    batch->size = 0;
+    batch->num_params = 0;
+}
+
+static void agm_param_batch_free(struct agm_param_batch *batch)
+{
+    free(batch->buf);
+    batch->buf = NULL;
+    batch->capacity = 0;
+    agm_param_batch_reset(batch);
+}
+
+// append one module parameter block and return a pointer to its (zeroed) param
+// data for the caller to fill, or NULL if the buffer could not grow
+static void *agm_param_batch_add(struct agm_param_batch *batch, uint32_t miid,
+                                 uint32_t param_id, size_t param_size)
+{
+    struct apm_module_param_data_t *header;
+    size_t block_size, pad_bytes;
+
+    block_size = sizeof(struct apm_module_param_data_t) + param_size;
+    pad_bytes = PADDING_8BYTE_ALIGN(block_size);
 
+    if (batch->size + block_size + pad_bytes > batch->capacity) {
+        size_t new_capacity = batch->capacity ? batch->capacity : 256;
+        while (new_capacity < batch->size + block_size + pad_bytes)
+            new_capacity *= 2;
+        uint8_t *new_buf = (uint8_t *)realloc(batch->buf, new_capacity);
+        if (!new_buf)
+            return NULL;
+        batch->buf = new_buf;
+        batch->capacity = new_capacity;
+    }
+
+    header = (struct apm_module_param_data_t *)(batch->buf + batch->size);
+    memset(header, 0, block_size + pad_bytes);
+    header->module_instance_id = miid;
+    header->param_id = param_id;
+    header->param_size = param_size;
+    header->error_code = 0x0;
+
+    batch->size += block_size + pad_bytes;
+    batch->num_params++;
+
+    return (uint8_t *)header + sizeof(struct apm_module_param_data_t);
+}
+
+// send every block queued in the batch with one setParam write, then reset it
+static int agm_param_batch_submit(char *frontend_name, struct agm_param_batch *batch)
+{
     int ret = 0;
-    struct apm_module_param_data_t* header = NULL;
+
+    if (batch->num_params == 0)
+        return 0;
+
+    printf("---\tsubmitting %u params (%zu bytes) in one setParam\n", batch->num_params, batch->size);
+    ret = set_agm_param(frontend_name, (void *)batch->buf, batch->size);
+
+    agm_param_batch_reset(batch);
+    return ret;
+}
+
+struct agm_param_batch *create_agm_param_batch(void)
+{
+    return (struct agm_param_batch *)calloc(1, sizeof(struct agm_param_batch));
+}
+
+void free_agm_param_batch(struct agm_param_batch *batch)
+{
+    if (!batch)
+        return;
+    agm_param_batch_free(batch);
+    free(batch);
+}
+
+int set_agm_params(struct agm_param_batch *batch, const char *frontend_name,
+                   const struct agm_module_param *params, unsigned int num_params)
+{
+    void *data;
+
+    agm_param_batch_reset(batch);
+    for (unsigned int i = 0; i < num_params; i++) {
+        data = agm_param_batch_add(batch, params[i].miid, params[i].param_id, params[i].size);
+        if (!data) {
+            agm_param_batch_reset(batch);
+            return -ENOMEM;
+        }
+        memcpy(data, params[i].data, params[i].size);
+    }
+
+    return agm_param_batch_submit((char *)frontend_name, batch);
+}
+
+// the configure_agm_* helpers below only queue their params in the batch; the
+// caller submits the batch once all the modules of the graph have been queued
+
+int configure_agm_mfc(struct agm_param_batch *batch, unsigned int rate, unsigned int channels,
+                      unsigned int bits, uint32_t miid)
+{
+    printf("---configure_agm_mfc\n");
+
     struct param_id_mfc_output_media_fmt_t *mfc_outMediaFmt;
     uint16_t* pcmChannel = NULL;
-    uint8_t* payload = NULL;
-    size_t payloadSize = 0, padBytes = 0, paramSize, paddedSize;
+    size_t paramSize;
 
     /* set PARAM_ID_MFC_OUTPUT_MEDIA_FORMAT */
-    
-    // Create payload container
-    paramSize = sizeof(struct param_id_mfc_output_media_fmt_t) + 
+
+    paramSize = sizeof(struct param_id_mfc_output_media_fmt_t) +
                     sizeof(uint16_t)*channels;
-    payload = create_agm_param_payload(paramSize, &payloadSize, &padBytes);
-    if (!payload) {
+    mfc_outMediaFmt = (struct param_id_mfc_output_media_fmt_t *)agm_param_batch_add(batch, miid,
+                            PARAM_ID_MFC_OUTPUT_MEDIA_FORMAT, paramSize);
+    if (!mfc_outMediaFmt) {
         return -ENOMEM;
     }
 
-    // Fill header
-    header = (struct apm_module_param_data_t*)payload;
-    header->module_instance_id = miid;
-    header->param_id = PARAM_ID_MFC_OUTPUT_MEDIA_FORMAT;
-    header->error_code = 0x0;
-    header->param_size = paramSize;
-
     // Fill actual param's components
-    mfc_outMediaFmt = (struct param_id_mfc_output_media_fmt_t*)(payload +
-               sizeof(struct apm_module_param_data_t));
     mfc_outMediaFmt->sampling_rate = rate;
     mfc_outMediaFmt->bit_width = bits;
     mfc_outMediaFmt->num_channels = channels;
 
-    pcmChannel = (uint16_t*)(payload + sizeof(struct apm_module_param_data_t) +
-                                       sizeof(struct param_id_mfc_output_media_fmt_t));
+    pcmChannel = (uint16_t*)((uint8_t *)mfc_outMediaFmt + sizeof(struct param_id_mfc_output_media_fmt_t));
     populateChannelMap(pcmChannel, channels);
-    
-    paddedSize = payloadSize + padBytes;
 
     printf("---\tpayload:\n");
-    printf("---\t\theader->module_instance_id: 0x%X\n", header->module_instance_id);
-    printf("---\t\theader->param_id: 0x%X (PARAM_ID_MFC_OUTPUT_MEDIA_FORMAT)\n", header->param_id);
+    printf("---\t\theader->module_instance_id: 0x%X\n", miid);
+    printf("---\t\theader->param_id: 0x%X (PARAM_ID_MFC_OUTPUT_MEDIA_FORMAT)\n", PARAM_ID_MFC_OUTPUT_MEDIA_FORMAT);
     printf("---\t\tmfc_outMediaFmt->sampling_rate: %d\n", rate);
     printf("---\t\tmfc_outMediaFmt->bit_width: %d\n", bits);
     printf("---\t\tmfc_outMediaFmt->num_channels: %d\n", channels);
 
-    ret = set_agm_param(frontend_name, (void *)payload, paddedSize);
-
-    free(payload);
-    return ret;
+    return 0;
 }
 
-int configure_agm_dma_sink(char *frontend_name, unsigned int frame_size_fcr, uint32_t miid)
+int configure_agm_dma_sink(struct agm_param_batch *batch, unsigned int frame_size_fcr, uint32_t miid)
 {
     printf("---configure_agm_dma_sink\n");
 
-    int ret = 0;
-    struct apm_module_param_data_t* header = NULL;
     struct param_id_hw_ep_frame_size_factor_t *dmaSink_frmSizeFcr;
     // struct param_id_hw_ep_mf_cfg_t *dmaSink_mfCfg;
-    uint8_t* payload = NULL;
-    size_t payloadSize = 0, padBytes = 0, paramSize, paddedSize;
 
 
     /* set PARAM_ID_HW_EP_FRAME_SIZE_FACTOR */
-    
-    paramSize = sizeof(struct param_id_hw_ep_frame_size_factor_t);
-    payload = create_agm_param_payload(paramSize, &payloadSize, &padBytes);
-    if (!payload) {
+
+    dmaSink_frmSizeFcr = (struct param_id_hw_ep_frame_size_factor_t *)agm_param_batch_add(batch, miid,
+                            PARAM_ID_HW_EP_FRAME_SIZE_FACTOR, sizeof(struct param_id_hw_ep_frame_size_factor_t));
+    if (!dmaSink_frmSizeFcr) {
         return -ENOMEM;
     }
-
-    // Fill header
-    header = (struct apm_module_param_data_t*)payload;
-    header->module_instance_id = miid;
-    header->param_id = PARAM_ID_HW_EP_FRAME_SIZE_FACTOR;
-    header->error_code = 0x0;
-    header->param_size = paramSize;
-
-    dmaSink_frmSizeFcr = (struct param_id_hw_ep_frame_size_factor_t*)(payload +
-               sizeof(struct apm_module_param_data_t));
     dmaSink_frmSizeFcr->frame_size_factor = frame_size_fcr;
-    
-    paddedSize = payloadSize + padBytes;
 
     printf("---\tpayload:\n");
-    printf("---\t\theader->module_instance_id: 0x%X\n", header->module_instance_id);
-    printf("---\t\theader->param_id: 0x%X (PARAM_ID_HW_EP_FRAME_SIZE_FACTOR)\n", header->param_id);
+    printf("---\t\theader->module_instance_id: 0x%X\n", miid);
+    printf("---\t\theader->param_id: 0x%X (PARAM_ID_HW_EP_FRAME_SIZE_FACTOR)\n", PARAM_ID_HW_EP_FRAME_SIZE_FACTOR);
     printf("---\t\tdmaSink_frmSizeFcr->frame_size_factor: %d\n", frame_size_fcr);
 
-    ret = set_agm_param(frontend_name, (void *)payload, paddedSize);
-
-    free(payload);
-
-    // if (ret != 0) {
-    //     return ret;  // Exit early if first param fails
-    // }
-
 
     // /* set PARAM_ID_HW_EP_MF_CFG */
 
-    // paramSize = sizeof(struct param_id_hw_ep_mf_cfg_t);
-    // payload = create_agm_param_payload(paramSize, &payloadSize, &padBytes);
-    // if (!payload) {
+    // dmaSink_mfCfg = (struct param_id_hw_ep_mf_cfg_t *)agm_param_batch_add(batch, miid,
+    //                         PARAM_ID_HW_EP_MF_CFG, sizeof(struct param_id_hw_ep_mf_cfg_t));
+    // if (!dmaSink_mfCfg) {
     //     return -ENOMEM;
     // }
-
-    // header = (struct apm_module_param_data_t*)payload;
-    // header->module_instance_id = miid;
-    // header->param_id = PARAM_ID_HW_EP_MF_CFG;
-    // header->error_code = 0x0;
-    // header->param_size = paramSize;
-
-    // dmaSink_mfCfg = (struct param_id_hw_ep_mf_cfg_t*)(payload +
-    //            sizeof(struct apm_module_param_data_t));
     // dmaSink_mfCfg->sample_rate  = 44100;
     // dmaSink_mfCfg->bit_width    = 32;
     // dmaSink_mfCfg->num_channels = 1;
     // dmaSink_mfCfg->data_format  = 1;
 
-    // paddedSize = payloadSize + padBytes;
-
     // printf("---\tpayload:\n");
-    // printf("---\t\theader->module_instance_id: 0x%X\n", header->module_instance_id);
-    // printf("---\t\theader->param_id: 0x%X (PARAM_ID_HW_EP_MF_CFG)\n", header->param_id);
+    // printf("---\t\theader->module_instance_id: 0x%X\n", miid);
+    // printf("---\t\theader->param_id: 0x%X (PARAM_ID_HW_EP_MF_CFG)\n", PARAM_ID_HW_EP_MF_CFG);
     // printf("---\t\tdmaSink_mfCfg->sample_rate:  %u\n", dmaSink_mfCfg->sample_rate);
     // printf("---\t\tdmaSink_mfCfg->bit_width:    %u\n", dmaSink_mfCfg->bit_width);
     // printf("---\t\tdmaSink_mfCfg->num_channels: %u\n", dmaSink_mfCfg->num_channels);
     // printf("---\t\tdmaSink_mfCfg->data_format:  %u\n", dmaSink_mfCfg->data_format);
 
-    // ret = set_agm_param(frontend_name, (void *)payload, paddedSize);
-
-    // free(payload);
-
-    return ret;
+    return 0;
 }
 
-int configure_agm_alsa_sink(char *frontend_name, unsigned int card_id, unsigned int device_id,
+int configure_agm_alsa_sink(struct agm_param_batch *batch, unsigned int card_id, unsigned int device_id,
                             unsigned int period_cnt, unsigned int frame_size_fcr, uint32_t miid)
 {
     printf("---configure_agm_alsa_sink\n");
 
-    int ret = 0;
-    struct apm_module_param_data_t* header = NULL;
     struct param_id_alsa_device_intf_cfg_t *alsaSink_devIntfCfg;
     struct param_id_hw_ep_frame_size_factor_t *alsaSink_frmSizeFcr;
-    uint8_t* payload = NULL;
-    size_t payloadSize = 0, padBytes = 0, paramSize, paddedSize;
 
 
     /* set PARAM_ID_ALSA_DEVICE_INTF_CFG */
 
-    // Create payload container
-    paramSize =  sizeof(struct param_id_alsa_device_intf_cfg_t);
-    payload = create_agm_param_payload(paramSize, &payloadSize, &padBytes);
-    if (!payload) {
+    alsaSink_devIntfCfg = (struct param_id_alsa_device_intf_cfg_t *)agm_param_batch_add(batch, miid,
+                            PARAM_ID_ALSA_DEVICE_INTF_CFG, sizeof(struct param_id_alsa_device_intf_cfg_t));
+    if (!alsaSink_devIntfCfg) {
         return -ENOMEM;
     }
 
-    // Fill header
-    header = (struct apm_module_param_data_t*)payload;
-    header->module_instance_id = miid;
-    header->param_id = PARAM_ID_ALSA_DEVICE_INTF_CFG;
-    header->error_code = 0x0;
-    header->param_size = paramSize;
-
     // Fill actual param's components
-    alsaSink_devIntfCfg = (struct param_id_alsa_device_intf_cfg_t*)(payload +
-               sizeof(struct apm_module_param_data_t));
     alsaSink_devIntfCfg->card_id = card_id;
     alsaSink_devIntfCfg->device_id = device_id;
     alsaSink_devIntfCfg->period_count = period_cnt;
     alsaSink_devIntfCfg->start_threshold = 0;    // auto
     alsaSink_devIntfCfg->stop_threshold = 0;     // auto
     alsaSink_devIntfCfg->silence_threshold = 0;  // auto
-    
-    paddedSize = payloadSize + padBytes;
 
     printf("---\tpayload:\n");
-    printf("---\t\theader->module_instance_id: 0x%X\n", header->module_instance_id);
-    printf("---\t\theader->param_id: 0x%X (PARAM_ID_ALSA_DEVICE_INTF_CFG)\n", header->param_id);
+    printf("---\t\theader->module_instance_id: 0x%X\n", miid);
+    printf("---\t\theader->param_id: 0x%X (PARAM_ID_ALSA_DEVICE_INTF_CFG)\n", PARAM_ID_ALSA_DEVICE_INTF_CFG);
     printf("---\t\talsaSink_devIntfCfg->card_id: %d\n", card_id);
     printf("---\t\talsaSink_devIntfCfg->device_id: %d\n", device_id);
     printf("---\t\talsaSink_devIntfCfg->period_count: %d\n", period_cnt);
@@ -1282,46 +1472,22 @@ int configure_agm_alsa_sink(char *frontend_name, unsigned int card_id, unsigned
     printf("---\t\talsaSink_devIntfCfg->stop_threshold: %d\n", 0);
     printf("---\t\talsaSink_devIntfCfg->silence_threshold: %d\n", 0);
 
-    ret = set_agm_param(frontend_name, (void *)payload, paddedSize);
-
-    free(payload);
-
-    if (ret != 0) {
-        return ret;  // Exit early if first param fails
-    }
-
 
     /* set PARAM_ID_HW_EP_FRAME_SIZE_FACTOR */
 
-    paramSize = sizeof(struct param_id_hw_ep_frame_size_factor_t);
-    payload = create_agm_param_payload(paramSize, &payloadSize, &padBytes);
-    if (!payload) {
+    alsaSink_frmSizeFcr = (struct param_id_hw_ep_frame_size_factor_t *)agm_param_batch_add(batch, miid,
+                            PARAM_ID_HW_EP_FRAME_SIZE_FACTOR, sizeof(struct param_id_hw_ep_frame_size_factor_t));
+    if (!alsaSink_frmSizeFcr) {
         return -ENOMEM;
     }
-
-    // Fill header
-    header = (struct apm_module_param_data_t*)payload;
-    header->module_instance_id = miid;
-    header->param_id = PARAM_ID_HW_EP_FRAME_SIZE_FACTOR;
-    header->error_code = 0x0;
-    header->param_size = paramSize;
-
-    alsaSink_frmSizeFcr = (struct param_id_hw_ep_frame_size_factor_t*)(payload +
-               sizeof(struct apm_module_param_data_t));
     alsaSink_frmSizeFcr->frame_size_factor = frame_size_fcr;
-    
-    paddedSize = payloadSize + padBytes;
 
     printf("---\tpayload:\n");
-    printf("---\t\theader->module_instance_id: 0x%X\n", header->module_instance_id);
-    printf("---\t\theader->param_id: 0x%X (PARAM_ID_HW_EP_FRAME_SIZE_FACTOR)\n", header->param_id);
+    printf("---\t\theader->module_instance_id: 0x%X\n", miid);
+    printf("---\t\theader->param_id: 0x%X (PARAM_ID_HW_EP_FRAME_SIZE_FACTOR)\n", PARAM_ID_HW_EP_FRAME_SIZE_FACTOR);
     printf("---\t\talsaSink_frmSizeFcr->frame_size_factor: %d\n", frame_size_fcr);
 
-    ret = set_agm_param(frontend_name, (void *)payload, paddedSize);
-
-    free(payload);
-
-    return ret;
+    return 0;
 }
 
 int inspect_agm_mfc(char *frontend_name, uint32_t miid)
@@ -1492,6 +1658,8 @@ int inspect_agm_dma_sink(char *frontend_name, uint32_t miid)
 // setup_agm_mixer_graph()
 int init_agm_mixer(unsigned int virtual_card)
 {
+    struct mixer_lock_guard lock;
+
     g_mixer = mixer_open(virtual_card);
     if (!g_mixer) {
         printf("Failed to open mixer\n");
@@ -1515,6 +1683,7 @@ int setup_agm_mixer_graph(char *frontend_name, char *backend_name, const char *b
     char *fe = NULL;
     char *be = NULL;
     struct device_config backend_config;
+    struct mixer_lock_guard lock;
 
     if (!g_mixer) {
         printf("Mixer not open; call init_agm_mixer() first\n");
@@ -1622,6 +1791,8 @@ int setup_agm_mixer_graph(char *frontend_name, char *backend_name, const char *b
     g_endpoints[g_num_endpoints].frontend_name = fe;
     g_endpoints[g_num_endpoints].backend_name = be;
     g_endpoints[g_num_endpoints].backend_config = backend_config;
+    g_endpoints[g_num_endpoints].tag_modules.clear(); // filled on first module lookup
+    g_endpoints[g_num_endpoints].tag_modules_loaded = false;
     g_num_endpoints++;
     fe = NULL;
     be = NULL;
@@ -1665,12 +1836,18 @@ int configure_agm_modules(unsigned int physical_card, unsigned int physical_devi
 {
     uint32_t miid = 0;
     uint32_t mid = 0;
+    struct agm_param_batch *batch = &g_param_batch;
+    struct mixer_lock_guard lock;
+
+    // the params of every module are queued in one batch and sent with a single
+    // setParam at the end
+    agm_param_batch_reset(batch);
 
     // retrieve the instance id of the PSPD MFC module...
     if (get_agm_module_iid(g_endpoints[0].frontend_name, g_endpoints[0].backend_name, PER_STREAM_PER_DEVICE_MFC, &miid, &mid) == 0) {
         printf("\n");
         // ...and use it to configure one of its params
-        if (configure_agm_mfc(g_endpoints[0].frontend_name, g_endpoints[0].backend_config.rate,
+        if (configure_agm_mfc(batch, g_endpoints[0].backend_config.rate,
                               g_endpoints[0].backend_config.ch, g_endpoints[0].backend_config.bits, miid)) {
             printf("Failed to configure pspd mfc\n");
             return -1;
@@ -1691,7 +1868,7 @@ int configure_agm_modules(unsigned int physical_card, unsigned int physical_devi
 
             // different configurations for different sink modules
             if(mid == MODULE_ID_CODEC_DMA_SINK)  {
-                if (configure_agm_dma_sink(g_endpoints[0].frontend_name, frame_size_fcr, miid)) {
+                if (configure_agm_dma_sink(batch, frame_size_fcr, miid)) {
                     printf("Failed to configure Coced DMA Sink\n");
                     return -1;
                 }
@@ -1699,7 +1876,7 @@ int configure_agm_modules(unsigned int physical_card, unsigned int physical_devi
             // if the module is Alsa Device Sink
             else if(mid == MODULE_ID_ALSA_DEVICE_SINK) {
                 // ...we configure two of its params
-                if (configure_agm_alsa_sink(g_endpoints[0].frontend_name, physical_card, physical_device,
+                if (configure_agm_alsa_sink(batch, physical_card, physical_device,
                                             period_count, frame_size_fcr, miid)) {
                     printf("Failed to configure Alsa Device Sink\n");
                     return -1;
@@ -1716,6 +1893,12 @@ int configure_agm_modules(unsigned int physical_card, unsigned int physical_devi
     }
     printf("\n");
 
+    if (agm_param_batch_submit(g_endpoints[0].frontend_name, batch)) {
+        printf("Failed to set module params\n");
+        return -1;
+    }
+    printf("\n");
+
 
     return 0;
 }
@@ -1767,6 +1950,8 @@ int inspect_agm_modules()
 
 void cleanup_agm_mixer(void)
 {
+    struct mixer_lock_guard lock;
+
     if (g_mixer != NULL) {
         // disconnect every direction's frontend/backend, then close the shared mixer
         for (int d = 0; d < g_num_endpoints; d++)
@@ -1781,6 +1966,10 @@ void cleanup_agm_mixer(void)
         free(g_endpoints[d].backend_name);
         g_endpoints[d].frontend_name = NULL;
         g_endpoints[d].backend_name = NULL;
+        g_endpoints[d].tag_modules.clear();
+        g_endpoints[d].tag_modules_loaded = false;
     }
     g_num_endpoints = 0;
+
+    agm_param_batch_free(&g_param_batch);
 }
\ No newline at end of file
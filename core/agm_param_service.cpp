@@ -0,0 +1,299 @@
+/*
+ * Copyright 2026 Victor Zappi
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+// DSP param automation: the audio thread only writes into a bounded lock-free queue
+// (multi-producer, single-consumer; after D. Vyukov's bounded MPMC queue), while all
+// the blocking mixer traffic happens on a normal-priority service thread, which
+// sleeps on a semaphore while nothing is posted or due.
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <atomic>
+#include <map>
+#include <vector>
+
+#include "agm_mixer.h"
+#include "agm_param_service.h"
+
+static_assert((AGM_PARAM_SERVICE_QUEUE_SIZE & (AGM_PARAM_SERVICE_QUEUE_SIZE - 1)) == 0,
+              "AGM_PARAM_SERVICE_QUEUE_SIZE must be a power of two");
+
+// one queued update; seq tells producers/consumer whose turn it is on this cell
+struct param_request {
+    std::atomic<size_t> seq;
+    unsigned int graph;
+    uint32_t miid;
+    uint32_t param_id;
+    uint32_t size;
+    uint8_t data[AGM_PARAM_SERVICE_MAX_PARAM_SIZE];
+};
+
+// coalescing key: a later update of the same param replaces the pending one
+struct param_key {
+    unsigned int graph;
+    uint32_t miid;
+    uint32_t param_id;
+
+    bool operator<(const param_key &o) const
+    {
+        if (graph != o.graph)
+            return graph < o.graph;
+        if (miid != o.miid)
+            return miid < o.miid;
+        return param_id < o.param_id;
+    }
+};
+
+static struct param_request g_queue[AGM_PARAM_SERVICE_QUEUE_SIZE];
+static std::atomic<size_t> g_enqueue_pos(0);
+static size_t g_dequeue_pos = 0;  // service thread only
+
+static pthread_t g_thread;
+static std::atomic_bool g_running(false);
+static unsigned int g_max_rate_hz = AGM_PARAM_SERVICE_DEFAULT_RATE_HZ;
+
+// posted once per queued update (and at cleanup) to wake the service thread
+static sem_t g_wakeup;
+
+// the service thread's own setParam payload buffer
+static struct agm_param_batch *g_batch = NULL;
+
+// stats, printed at cleanup
+static std::atomic<unsigned long> g_posted(0);
+static std::atomic<unsigned long> g_dropped(0);
+static unsigned long g_coalesced = 0;
+static unsigned long g_writes = 0;
+
+// ---------------------------------------------------------------------------
+// queue
+// ---------------------------------------------------------------------------
+
+static bool queue_pop(struct param_request *out)
+{
+    struct param_request *cell = &g_queue[g_dequeue_pos & (AGM_PARAM_SERVICE_QUEUE_SIZE - 1)];
+    size_t seq = cell->seq.load(std::memory_order_acquire);
+
+    if (seq != g_dequeue_pos + 1)
+        return false;  // empty (or the producer of this cell is not done yet)
+
+    out->graph = cell->graph;
+    out->miid = cell->miid;
+    out->param_id = cell->param_id;
+    out->size = cell->size;
+    memcpy(out->data, cell->data, cell->size);
+
+    // hand the cell back to the producers, one lap ahead
+    cell->seq.store(g_dequeue_pos + AGM_PARAM_SERVICE_QUEUE_SIZE, std::memory_order_release);
+    g_dequeue_pos++;
+    return true;
+}
+
+bool post_agm_param(unsigned int graph, uint32_t miid, uint32_t param_id,
+                    const void *data, uint32_t size)
+{
+    struct param_request *cell;
+    size_t pos;
+
+    if (!g_running.load(std::memory_order_relaxed) || size > AGM_PARAM_SERVICE_MAX_PARAM_SIZE)
+        return false;
+
+    pos = g_enqueue_pos.load(std::memory_order_relaxed);
+    while (1) {
+        cell = &g_queue[pos & (AGM_PARAM_SERVICE_QUEUE_SIZE - 1)];
+        size_t seq = cell->seq.load(std::memory_order_acquire);
+        intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+
+        if (dif == 0) {
+            // cell free for this lap: claim it
+            if (g_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        } else if (dif < 0) {
+            // consumer one full lap behind: queue full
+            g_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            pos = g_enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    cell->graph = graph;
+    cell->miid = miid;
+    cell->param_id = param_id;
+    cell->size = size;
+    memcpy(cell->data, data, size);
+    cell->seq.store(pos + 1, std::memory_order_release);
+
+    // never blocks; only enters the kernel when the service thread is asleep
+    sem_post(&g_wakeup);
+
+    g_posted.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// service thread
+// ---------------------------------------------------------------------------
+
+// send every pending param, one batched setParam per graph
+static void flush_pending(std::map<struct param_key, std::vector<uint8_t>> &pending)
+{
+    std::vector<struct agm_module_param> params;
+    auto it = pending.begin();
+
+    while (it != pending.end()) {
+        unsigned int graph = it->first.graph;
+        const char *frontend_name = get_agm_frontend_name(graph);
+
+        params.clear();
+        for (; it != pending.end() && it->first.graph == graph; ++it) {
+            struct agm_module_param param;
+            param.miid = it->first.miid;
+            param.param_id = it->first.param_id;
+            param.data = it->second.data();
+            param.size = (uint32_t)it->second.size();
+            params.push_back(param);
+        }
+
+        if (!frontend_name) {
+            fprintf(stderr, "agm_param_service: no graph %u, %zu params dropped\n", graph, params.size());
+            continue;
+        }
+        if (set_agm_params(g_batch, frontend_name, params.data(), (unsigned int)params.size()) < 0)
+            fprintf(stderr, "agm_param_service: setParam on %s failed\n", frontend_name);
+        g_writes++;
+    }
+
+    pending.clear();
+}
+
+static void *service_thread_func(void *arg)
+{
+    (void)arg;
+    std::map<struct param_key, std::vector<uint8_t>> pending;
+    struct param_request req;
+    struct timespec next;
+    long period_ns = 1000000000L / g_max_rate_hz;
+
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    while (1) {
+        // sleep until something is posted (or cleanup wakes us up); with updates
+        // waiting for their flush, only until it is due
+        int ret;
+        do {
+            ret = pending.empty() ? sem_wait(&g_wakeup)
+                                  : sem_clockwait(&g_wakeup, CLOCK_MONOTONIC, &next);
+        } while (ret != 0 && errno == EINTR);
+        if (!g_running.load())
+            break;
+
+        // the queue is drained below, so the posts counted so far are served
+        while (sem_trywait(&g_wakeup) == 0)
+            ;
+
+        // move everything posted into pending, so the queue never fills up while
+        // a flush is due; the latest value of each (graph, miid, param_id) wins
+        while (queue_pop(&req)) {
+            struct param_key key = { req.graph, req.miid, req.param_id };
+            std::vector<uint8_t> &value = pending[key];
+            if (!value.empty())
+                g_coalesced++;
+            value.assign(req.data, req.data + req.size);
+        }
+
+        // at most max_rate_hz mixer writes per graph per second
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (pending.empty() || now.tv_sec < next.tv_sec ||
+            (now.tv_sec == next.tv_sec && now.tv_nsec < next.tv_nsec))
+            continue;
+        flush_pending(pending);
+
+        next = now;
+        next.tv_nsec += period_ns;
+        while (next.tv_nsec >= 1000000000L) {
+            next.tv_nsec -= 1000000000L;
+            next.tv_sec++;
+        }
+    }
+
+    return NULL;
+}
+
+// ---------------------------------------------------------------------------
+// lifecycle
+// ---------------------------------------------------------------------------
+
+int init_agm_param_service(unsigned int max_rate_hz)
+{
+    if (g_running.load())
+        return 0;
+
+    g_max_rate_hz = max_rate_hz ? max_rate_hz : AGM_PARAM_SERVICE_DEFAULT_RATE_HZ;
+
+    // cell i is free for the producer holding position i
+    for (size_t i = 0; i < AGM_PARAM_SERVICE_QUEUE_SIZE; i++)
+        g_queue[i].seq.store(i, std::memory_order_relaxed);
+    g_enqueue_pos.store(0);
+    g_dequeue_pos = 0;
+    g_posted.store(0);
+    g_dropped.store(0);
+    g_coalesced = 0;
+    g_writes = 0;
+
+    g_batch = create_agm_param_batch();
+    if (!g_batch || sem_init(&g_wakeup, 0, 0) != 0) {
+        fprintf(stderr, "agm_param_service: failed to allocate\n");
+        free_agm_param_batch(g_batch);
+        g_batch = NULL;
+        return -1;
+    }
+
+    // normal priority on purpose: this thread does the blocking mixer writes and
+    // must never compete with the audio thread
+    g_running.store(true);
+    if (pthread_create(&g_thread, NULL, service_thread_func, NULL) != 0) {
+        fprintf(stderr, "agm_param_service: failed to create thread\n");
+        g_running.store(false);
+        sem_destroy(&g_wakeup);
+        free_agm_param_batch(g_batch);
+        g_batch = NULL;
+        return -1;
+    }
+
+    printf("agm_param_service: running at up to %u Hz\n\n", g_max_rate_hz);
+    return 0;
+}
+
+void cleanup_agm_param_service(void)
+{
+    if (!g_running.load())
+        return;
+
+    g_running.store(false);
+    sem_post(&g_wakeup);
+    pthread_join(g_thread, NULL);
+    sem_destroy(&g_wakeup);
+    free_agm_param_batch(g_batch);
+    g_batch = NULL;
+
+    printf("agm_param_service: %lu posted, %lu coalesced, %lu dropped, %lu setParam writes\n",
+           g_posted.load(), g_coalesced, g_dropped.load(), g_writes);
+}
+
+int get_agm_param_target(unsigned int graph, uint32_t tag_id, uint32_t *miid)
+{
+    const char *frontend_name = get_agm_frontend_name(graph);
+    uint32_t mid;
+
+    if (!frontend_name)
+        return -ENODEV;
+
+    return lookup_agm_module(frontend_name, tag_id, miid, &mid);
+}
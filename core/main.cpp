@@ -32,6 +32,7 @@ configure, build and clean commands in CMakeLists.txt
 #include "pcm_utils.h"
 #include "hw_mixer.h"
 #include "agm_mixer.h"
+#include "agm_param_service.h"
 #include "render.h"
 
 // we assume a little-endian CPU: sample conversion copies the host integer's low
@@ -357,7 +358,9 @@ static int setup_hw_mixer_paths(struct settings *settings)
 
 // build the AGM graph for every active direction. The mixer must already be open
 // (init_agm_mixer); setup_agm_mixer_graph records each direction's endpoints so
-// cleanup_agm_mixer can tear both down.
+// cleanup_agm_mixer can tear both down. The graphs' tag tables are read here too,
+// before the audio thread starts, so that module lookups from setup() never touch
+// the mixer.
 static int set_agm_mixer_graphs(struct settings *settings)
 {
     struct pcm_stream *streams[NUM_DIRS] = { &settings->playback, &settings->capture };
@@ -371,6 +374,10 @@ static int set_agm_mixer_graphs(struct settings *settings)
                                   s->devicepp_kv, s->device_kv) < 0)
             return -1;
     }
+
+    // not fatal: audio runs without it, only DSP param lookups will fail
+    if (load_agm_module_tables() < 0)
+        fprintf(stderr, "warning: could not read the graphs' tag tables, DSP param lookups will fail\n");
     return 0;
 }
 
@@ -624,7 +631,18 @@ int main(int argc, char **argv)
         return EXIT_FAILURE;
     }
 
+    // DSP params posted from render() are applied by this thread, off the audio path
+    if (init_agm_param_service(AGM_PARAM_SERVICE_DEFAULT_RATE_HZ) < 0) {
+        cleanup_pcm(ctx);
+        cleanup_agm_mixer();
+        cleanup_hw_mixer();
+        cleanup_ctx(ctx);
+        cleanup_settings(&settings);
+        return EXIT_FAILURE;
+    }
+
     if (start_audio(&settings, ctx) < 0) {
+        cleanup_agm_param_service();
         cleanup_pcm(ctx);
         cleanup_agm_mixer();
         cleanup_hw_mixer();
@@ -633,6 +651,7 @@ int main(int argc, char **argv)
         return EXIT_FAILURE;
     }
 
+    cleanup_agm_param_service();
     cleanup_pcm(ctx);
     cleanup_agm_mixer();
     cleanup_hw_mixer();
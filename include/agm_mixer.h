@@ -38,6 +38,16 @@
 #include <agm/agm_api.h> // for struct agm_key_value
 
 
+// one module parameter to set: data points to size bytes of param payload
+// (without the module header, which is added when the param is packed)
+struct agm_module_param {
+    uint32_t miid;
+    uint32_t param_id;
+    const void *data;
+    uint32_t size;
+};
+
+
 // open the mixer on the virtual card (shared by both directions)
 int init_agm_mixer(unsigned int virtual_card);
 
@@ -52,6 +62,32 @@ int configure_agm_modules(unsigned int physical_card, unsigned int physical_devi
 
 int inspect_agm_modules();
 
+// frontend of the graph-th graph set up (in setup order), or NULL if there is none
+const char *get_agm_frontend_name(unsigned int graph);
+
+// read the tag/module table of every graph set up so far (one getTaggedInfo each)
+// into the lookup cache. Blocking mixer traffic: call it once the graphs are set up,
+// before the audio thread starts. Returns 0, or the first error.
+int load_agm_module_tables(void);
+
+// resolve the module carrying tag_id in the graph connected to frontend_name (e.g. to
+// address runtime parameter writes). Served from the cache load_agm_module_tables()
+// filled, with no mixer access. Returns 0 if found, 1 if the graph has no such tag,
+// -ENODATA if its table was not loaded, <0 on other errors.
+int lookup_agm_module(const char *frontend_name, uint32_t tag_id, uint32_t *miid, uint32_t *mid);
+
+// reusable payload buffer for set_agm_params(); one per calling thread
+struct agm_param_batch;
+struct agm_param_batch *create_agm_param_batch(void);
+void free_agm_param_batch(struct agm_param_batch *batch);
+
+// pack several module params (8-byte aligned each) into batch and send them to the
+// graph connected to frontend_name with a single setParam write. Blocking mixer
+// call (serialized with the other mixer operations): never use it from the audio
+// thread. At runtime it is the agm_param_service thread's.
+int set_agm_params(struct agm_param_batch *batch, const char *frontend_name,
+                   const struct agm_module_param *params, unsigned int num_params);
+
 int set_agm_ecref_path(char* cp_frontend_name, char* pb_backend_name, bool enable);
 
 void cleanup_agm_mixer(void);
@@ -0,0 +1,40 @@
+/*
+ * Copyright 2026 Victor Zappi
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+// agm_param_service.h
+// background service that applies AudioReach DSP module params (gain, MBDRC, MFC...)
+// while audio runs. render() (or any control thread) posts updates into a bounded
+// lock-free queue; a non-RT thread coalesces them per (miid, param_id), keeps only
+// the latest value, and flushes them at most max_rate_hz times per second, one
+// batched setParam write per graph.
+#ifndef __AGM_PARAM_SERVICE_H__
+#define __AGM_PARAM_SERVICE_H__
+
+#include <stdint.h>
+
+#define AGM_PARAM_SERVICE_DEFAULT_RATE_HZ   50
+#define AGM_PARAM_SERVICE_MAX_PARAM_SIZE    256  // bytes of param data per request
+#define AGM_PARAM_SERVICE_QUEUE_SIZE        128  // pending requests (power of two)
+
+// start the service thread; the graphs must already be set up (setup_agm_mixer_graph)
+int init_agm_param_service(unsigned int max_rate_hz);
+
+// stop the service thread; updates still queued are dropped
+void cleanup_agm_param_service(void);
+
+// instance id of the module tagged tag_id in a graph (graphs are indexed in setup
+// order: 0 = playback, 1 = capture). Only reads the tag tables cached at graph setup,
+// no mixer access, so it is fine in setup(). Returns 0 if found, 1 if the graph has
+// no such tag, <0 on error.
+int get_agm_param_target(unsigned int graph, uint32_t tag_id, uint32_t *miid);
+
+// queue a param update for a module of a graph; data is size bytes of param payload
+// (no module header). Real-time safe: no locks, no allocation, and the only syscall
+// is a non-blocking wake-up when the service thread is asleep. Returns
+// false if the service is not running, size is too large, or the queue is full.
+bool post_agm_param(unsigned int graph, uint32_t miid, uint32_t param_id,
+                    const void *data, uint32_t size);
+
+#endif // __AGM_PARAM_SERVICE_H__
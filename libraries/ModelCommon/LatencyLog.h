@@ -0,0 +1,83 @@
+/*
+ * Copyright 2026 Victor Zappi
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+// LatencyLog: the inference times of a model, shared by OrtModel and QnnModel.
+//
+// The audio thread records every call into a ring of the last window calls,
+// without locking or allocating. stats() sorts a copy of the ring, so it
+// belongs outside the audio thread, but it can run while the audio thread
+// records: slots and count are atomics. A slot overwritten during the copy just
+// contributes a newer sample. Header-only, no dependencies.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <stddef.h>
+#include <vector>
+
+namespace ar
+{
+    // Latency of the recent calls, in microseconds
+    struct LatencyStats
+    {
+        size_t count = 0; // calls covered: the last LatencyLog::window at most
+        float minUs = 0.f;
+        float p50Us = 0.f;
+        float p99Us = 0.f;
+        float maxUs = 0.f;
+    };
+
+    class LatencyLog
+    {
+    public:
+        static const size_t window = 1024;
+
+        LatencyLog()
+        {
+            for (size_t i = 0; i < window; ++i)
+                slots[i].store(0.f, std::memory_order_relaxed);
+        }
+
+        LatencyLog(const LatencyLog &) = delete;
+        LatencyLog &operator=(const LatencyLog &) = delete;
+
+        // audio thread
+        void record(float us)
+        {
+            size_t n = count.load(std::memory_order_relaxed);
+            slots[n % window].store(us, std::memory_order_relaxed);
+            count.store(n + 1, std::memory_order_release);
+        }
+
+        // any thread
+        LatencyStats stats() const
+        {
+            LatencyStats stats;
+            size_t n = std::min(count.load(std::memory_order_acquire), window);
+            if (n == 0)
+                return stats;
+
+            std::vector<float> sorted(n);
+            for (size_t i = 0; i < n; ++i)
+                sorted[i] = slots[i].load(std::memory_order_relaxed);
+            std::sort(sorted.begin(), sorted.end());
+            stats.count = n;
+            stats.minUs = sorted.front();
+            stats.p50Us = sorted[(n - 1) / 2];
+            stats.p99Us = sorted[(n - 1) * 99 / 100];
+            stats.maxUs = sorted.back();
+            return stats;
+        }
+
+        // Forget the recorded calls. Not while the audio thread records: a call
+        // recorded at the same time may survive the reset
+        void reset() { count.store(0, std::memory_order_release); }
+
+    private:
+        std::atomic<float> slots[window];
+        std::atomic<size_t> count{0};
+    };
+} // namespace ar
@@ -0,0 +1,154 @@
+/*
+ * Copyright 2026 Victor Zappi
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+// ModelCache: the on-disk cache of a prepared model, shared by OrtModel (the
+// optimized graph, <model>.opt.ort) and QnnModel (the context binary,
+// <dlc>.<backend>.ctx.bin).
+//
+// Next to the cache file, a stamp file records what it was built from: the
+// build settings (runtime version, backend...), the source model's size and
+// mtime, then a hash of the source. Any difference means the cache is rebuilt.
+// The hash is only computed when the size or mtime changed, so a cache hit
+// doesn't read the whole model. A new cache is published through a temporary
+// file and the stamp is written last, so an interrupted save never leaves a
+// stamp next to a partial cache. Header-only, no dependencies.
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <sys/stat.h>
+
+namespace ar
+{
+    namespace cache
+    {
+        // size and mtime of path, without reading it; "" if it can't be stat'd
+        inline std::string fileStamp(const std::string &path)
+        {
+            struct stat st;
+            if (stat(path.c_str(), &st) != 0)
+                return "";
+
+            char stamp[128];
+            snprintf(stamp, sizeof(stamp), "size %lld\nmtime %lld.%09ld\n",
+                     (long long)st.st_size, (long long)st.st_mtim.tv_sec, (long)st.st_mtim.tv_nsec);
+            return stamp;
+        }
+
+        // FNV-1a 64 over the whole file; "" if it can't be read
+        inline std::string contentStamp(const std::string &path)
+        {
+            FILE *f = fopen(path.c_str(), "rb");
+            if (f == nullptr)
+                return "";
+
+            uint64_t hash = 0xcbf29ce484222325ULL;
+            unsigned char buf[64 * 1024];
+            size_t n;
+            while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+            {
+                for (size_t i = 0; i < n; i++)
+                {
+                    hash ^= buf[i];
+                    hash *= 0x100000001b3ULL;
+                }
+            }
+            fclose(f);
+
+            char stamp[64];
+            snprintf(stamp, sizeof(stamp), "fnv1a64 %016llx\n", (unsigned long long)hash);
+            return stamp;
+        }
+
+        inline bool readText(const std::string &path, std::string &text)
+        {
+            FILE *f = fopen(path.c_str(), "r");
+            if (f == nullptr)
+                return false;
+
+            char buf[256];
+            size_t n;
+            text.clear();
+            while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+                text.append(buf, n);
+            fclose(f);
+            return true;
+        }
+
+        inline bool writeText(const std::string &path, const std::string &text)
+        {
+            FILE *f = fopen(path.c_str(), "w");
+            if (f == nullptr)
+                return false;
+
+            bool ok = fwrite(text.data(), 1, text.size(), f) == text.size();
+            ok = (fclose(f) == 0) && ok;
+            return ok;
+        }
+
+        struct Lookup
+        {
+            bool upToDate = false; // the cache can be loaded instead of the source
+            std::string stamp;     // the source's stamp, to publish() a rebuilt cache with; "" if unknown
+        };
+
+        // Check the cache whose stamp is at stampPath against sourcePath, built
+        // with settings (whole lines, each ending in '\n'). If the source was
+        // touched but its content is the same, the stamp is refreshed, so the next
+        // lookup doesn't hash it again.
+        inline Lookup lookup(const std::string &stampPath, const std::string &settings, const std::string &sourcePath)
+        {
+            Lookup result;
+            std::string file = fileStamp(sourcePath);
+            if (file.empty())
+                return result;
+
+            std::string cached;
+            bool haveCached = readText(stampPath, cached);
+            std::string prefix = settings + file;
+            if (haveCached && cached.compare(0, prefix.size(), prefix) == 0)
+            {
+                result.upToDate = true;
+                result.stamp = cached;
+                return result;
+            }
+
+            std::string content = contentStamp(sourcePath);
+            if (content.empty())
+                return result;
+            result.stamp = prefix + content;
+            if (haveCached && cached.size() >= settings.size() + content.size() &&
+                cached.compare(0, settings.size(), settings) == 0 &&
+                cached.compare(cached.size() - content.size(), content.size(), content) == 0)
+            {
+                result.upToDate = true;
+                writeText(stampPath, result.stamp);
+            }
+            return result;
+        }
+
+        // Replace cachePath with the complete new cache in tmpPath, then write its
+        // stamp. On failure tmpPath is removed and no stamp is left, so the next
+        // load rebuilds the cache.
+        inline bool publish(const std::string &tmpPath, const std::string &cachePath,
+                            const std::string &stampPath, const std::string &stamp)
+        {
+            remove(stampPath.c_str());
+            if (rename(tmpPath.c_str(), cachePath.c_str()) != 0)
+            {
+                remove(tmpPath.c_str());
+                return false;
+            }
+            if (!writeText(stampPath, stamp))
+            {
+                remove(stampPath.c_str());
+                return false;
+            }
+            return true;
+        }
+    } // namespace cache
+} // namespace ar
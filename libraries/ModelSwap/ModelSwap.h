@@ -0,0 +1,237 @@
+/*
+ * Copyright 2026 Victor Zappi
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+// ModelSwap: replace a running model (NAM, OrtModel, QnnModel, ...) without
+// stopping the audio.
+//
+// Loading a model and getting it ready (nam::get_dsp + Reset + prewarm,
+// OrtModel::setup, QnnModel::load + warmup) takes far too long for the audio
+// thread. Here a loader thread does all of that; render() then picks the new
+// model up with an atomic pointer exchange, runs old and new side by side for a
+// crossfade window, and hands the old one back to the loader thread, which
+// deletes it. The audio thread never allocates, frees, blocks or waits. The
+// loader thread never runs at real-time priority: started from setup(), often
+// on the SCHED_FIFO audio thread, it drops to SCHED_OTHER so that a load can't
+// starve render().
+//
+// Typical use, with NAM:
+//
+//   ar::ModelSwap<nam::DSP, double> swap;
+//   swap.setup(std::move(model), ctx->period_size);               // in setup()
+//   swap.requestSwap([=] {                                        // any non-audio thread
+//       auto m = nam::get_dsp(std::filesystem::path(path));
+//       if (m) { m->Reset(sampleRate, periodSize); m->prewarm(); }
+//       return m;
+//   });
+//   swap.process(out, frames, [&](nam::DSP &m, double *dst) {     // in render()
+//       m.process(&inputPtr, &dst, frames);
+//   });
+//
+// OrtModel and QnnModel work the same way: the loader calls setup() / load() and
+// warmup() and returns the model, run() calls run()/runBound() / execute() with
+// dst as the output buffer. A retired model is just deleted, so Model's
+// destructor must release everything (both do). Models with state start the
+// crossfade from their initial state. Header-only, no dependencies.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <pthread.h>
+#include <sched.h>
+#include <thread>
+#include <vector>
+
+namespace ar
+{
+    template <typename Model, typename T = float>
+    class ModelSwap
+    {
+    public:
+        // Runs on the loader thread: load the model and get it ready to process
+        // (reset, prewarm...). Return nullptr on failure; the current model stays.
+        using Loader = std::function<std::unique_ptr<Model>()>;
+
+        ModelSwap() {}
+        ~ModelSwap() { reset(); }
+
+        ModelSwap(const ModelSwap &) = delete;
+        ModelSwap &operator=(const ModelSwap &) = delete;
+
+        // Start with an already loaded model and the loader thread. maxFrames
+        // (per process() call) and channels (interleaved samples per frame) size
+        // the buffer the incoming model renders into during a crossfade.
+        void setup(std::unique_ptr<Model> initial, size_t maxFrames, unsigned channels = 1)
+        {
+            reset();
+            active = initial.release();
+            this->channels = channels;
+            scratch.assign(maxFrames * channels, (T)0);
+            stopping = false;
+            worker = std::thread(&ModelSwap::workerLoop, this);
+        }
+
+        // Length of the linear crossfade, in frames; 0 switches at a block
+        // boundary. Call before requesting swaps, not from the audio thread.
+        void setCrossfade(size_t frames) { fadeFrames = frames; }
+
+        // Load a model in the background and swap to it once ready. Call from
+        // any thread but the audio one. If a request is still waiting (not loaded
+        // yet), it is replaced: the latest one wins.
+        void requestSwap(Loader loader)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                request = std::move(loader);
+            }
+            cv.notify_one();
+        }
+
+        // true while a requested model is loading, waiting for render() or
+        // fading in
+        bool swapInProgress() const
+        {
+            return loading.load() || pending.load() != nullptr || fading.load();
+        }
+
+        // Audio thread. run(model, dst) renders the block of model into dst
+        // (frames * channels samples); the output of the active model goes to
+        // output, blended with the incoming one during a crossfade.
+        template <typename Run>
+        void process(T *output, size_t frames, Run &&run)
+        {
+            if (!incoming && pending.load(std::memory_order_acquire))
+            {
+                incoming = pending.exchange(nullptr, std::memory_order_acq_rel);
+                fadePos = 0;
+                fading.store(incoming != nullptr);
+            }
+
+            run(*active, output);
+            if (!incoming)
+                return;
+
+            run(*incoming, scratch.data());
+            for (size_t n = 0; n < frames; ++n)
+            {
+                // gain of the incoming model, reaching 1 on the last frame of the fade
+                T gain = fadeFrames == 0 ? (T)1 : std::min((T)1, (T)(fadePos + n + 1) / (T)fadeFrames);
+                for (unsigned c = 0; c < channels; ++c)
+                {
+                    T &out = output[n * channels + c];
+                    out += gain * (scratch[n * channels + c] - out);
+                }
+            }
+            fadePos += frames;
+
+            // done: the old model goes to the loader thread to be deleted. If it
+            // hasn't collected the previous one yet, the new model just plays
+            // alone (gain 1) for another block
+            if (fadePos >= fadeFrames && retired.load(std::memory_order_acquire) == nullptr)
+            {
+                retired.store(active, std::memory_order_release);
+                active = incoming;
+                incoming = nullptr;
+                fading.store(false);
+            }
+        }
+
+        // The model currently playing (audio thread, or before any swap)
+        Model &current() { return *active; }
+
+        // Join the loader thread and delete any model not playing. Not from the
+        // audio thread; render() must not run anymore.
+        void stop()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+                request = nullptr;
+            }
+            cv.notify_one();
+            if (worker.joinable())
+                worker.join();
+            delete pending.exchange(nullptr);
+            delete retired.exchange(nullptr);
+            // a fade cut short: keep the model that was playing
+            delete incoming;
+            incoming = nullptr;
+            fading.store(false);
+        }
+
+        // stop() and delete the playing model too
+        void reset()
+        {
+            stop();
+            delete active;
+            active = nullptr;
+        }
+
+    private:
+        void workerLoop()
+        {
+            // don't inherit the audio thread's priority
+            struct sched_param normal = {};
+            pthread_setschedparam(pthread_self(), SCHED_OTHER, &normal);
+
+            for (;;)
+            {
+                Loader loader;
+                {
+                    // wake up periodically to collect retired models too
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cv.wait_for(lock, std::chrono::milliseconds(20), [this] { return stopping || request; });
+                    if (stopping)
+                        return;
+                    std::swap(loader, request);
+                    loading.store((bool)loader);
+                }
+                delete retired.exchange(nullptr, std::memory_order_acq_rel);
+                if (!loader)
+                    continue;
+
+                std::unique_ptr<Model> model = loader();
+                if (!model)
+                {
+                    loading.store(false);
+                    fprintf(stderr, "ModelSwap: loading the new model failed, keeping the current one\n");
+                    continue;
+                }
+                // a model loaded earlier that render() hasn't picked up is
+                // superseded. Published before loading is cleared, so that
+                // swapInProgress() doesn't read false in between
+                delete pending.exchange(model.release(), std::memory_order_acq_rel);
+                loading.store(false);
+            }
+        }
+
+        // audio thread only
+        Model *active = nullptr;
+        Model *incoming = nullptr;
+        size_t fadePos = 0;
+        std::vector<T> scratch;
+
+        size_t fadeFrames = 0;
+        unsigned channels = 1;
+
+        // loader thread -> audio thread (ready to play) and back (to delete)
+        std::atomic<Model *> pending{nullptr};
+        std::atomic<Model *> retired{nullptr};
+        std::atomic<bool> loading{false};
+        std::atomic<bool> fading{false};
+
+        std::thread worker;
+        std::mutex mutex;
+        std::condition_variable cv;
+        Loader request; // guarded by mutex
+        bool stopping = false;
+    };
+} // namespace ar
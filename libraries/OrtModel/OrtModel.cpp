@@ -4,10 +4,30 @@
  */
 
 #include "OrtModel.h"
+#include "onnxruntime_session_options_config_keys.h"
+#include "ModelCache.h"
 #include <iostream>
 #include <thread>
 
 #include <numeric> // std::accumulate()
+#include <algorithm> // std::sort()
+#include <cstdlib> // aligned_alloc()
+#include <cstring> // memset(), memcpy()
+#include <cstdio>  // rename(), remove()
+#include <mutex>
+#include <sys/mman.h> // mmap()
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cmath>   // lrintf()
+#include <limits>
+#include <type_traits>
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+// alignment of runBound() buffers, one cache line/widest SIMD register
+#define ORT_BUFFER_ALIGNMENT 64
 
 // ── Lazy-initialized globals (avoids static init order fiasco) ───────────────
 static Ort::MemoryInfo& getMemoryInfo() {
@@ -20,6 +40,230 @@ static Ort::RunOptions& getRunOptions() {
     return opts;
 }
 
+static OrtRuntimeConfig& getRuntimeConfig() {
+    static OrtRuntimeConfig config;
+    return config;
+}
+
+static bool runtimeStarted = false;
+
+// One Env for the whole process, with the global thread pool every multithreaded
+// session runs on. Created on first use, with the config at that time
+static Ort::Env& getEnv() {
+    static Ort::Env env = []() {
+        const OrtRuntimeConfig& config = getRuntimeConfig();
+        int intraOpThreads = config.intraOpThreads > 0 ? config.intraOpThreads : (int)std::thread::hardware_concurrency();
+
+        Ort::ThreadingOptions threadingOptions;
+        threadingOptions.SetGlobalIntraOpNumThreads(intraOpThreads);
+        threadingOptions.SetGlobalInterOpNumThreads(config.interOpThreads);
+        threadingOptions.SetGlobalSpinControl(config.allowSpinning ? 1 : 0);
+        if(config.denormalsAsZero)
+            threadingOptions.SetGlobalDenormalAsZero();
+        if(!config.intraOpAffinity.empty())
+            Ort::ThrowOnError(Ort::GetApi().SetGlobalIntraOpThreadAffinity(threadingOptions, config.intraOpAffinity.c_str()));
+
+        runtimeStarted = true;
+        printf("ONNX Runtime global pool: %d intra-op, %d inter-op threads, spinning %s, denormals-as-zero %s, affinity %s\n",
+               intraOpThreads, config.interOpThreads, config.allowSpinning ? "on" : "off",
+               config.denormalsAsZero ? "on" : "off", config.intraOpAffinity.empty() ? "none" : config.intraOpAffinity.c_str());
+        return Ort::Env(threadingOptions, OrtLoggingLevel::ORT_LOGGING_LEVEL_WARNING, "OrtModel");
+    }();
+    return env;
+}
+
+// ── Optimized model cache ───────────────────────────────────────────────────
+// <model>.opt.ort holds the graph as optimized by ORT_ENABLE_ALL, in ORT format;
+// <model>.opt.ort.stamp records what it was built from (see ModelCache.h). The
+// build settings are the ORT version and the optimization level
+
+static string modelCacheSettings()
+{
+    char settings[128];
+    snprintf(settings, sizeof(settings), "ort %s\nopt %d\n",
+             Ort::GetVersionString().c_str(), (int)GraphOptimizationLevel::ORT_ENABLE_ALL);
+    return settings;
+}
+
+// ── Shared models ───────────────────────────────────────────────────────────
+// One read-only mapping and one pre-packed weights container per source model,
+// reference counted across all OrtModel instances of the process. The mapped file
+// is the source model or its optimized cache, whichever the first instance loaded
+struct SharedModel {
+    string path;            // file mapped
+    void* data = nullptr;   // mmap'd file, nullptr if it could not be mapped
+    size_t size = 0;
+    OrtPrepackedWeightsContainer* prepacked = nullptr;
+    int refs = 0;
+};
+
+static std::mutex sharedModelsMutex;
+
+static std::map<string, SharedModel>& getSharedModels() {
+    static std::map<string, SharedModel> models;
+    return models;
+}
+
+// The entry of modelPath, mapping loadPath if it is created now
+static SharedModel acquireSharedModel(const string& modelPath, const string& loadPath)
+{
+    std::lock_guard<std::mutex> lock(sharedModelsMutex);
+    SharedModel& model = getSharedModels()[modelPath];
+    if(model.refs == 0)
+    {
+        // first, so that a failure leaves nothing behind
+        OrtStatus* status = Ort::GetApi().CreatePrepackedWeightsContainer(&model.prepacked);
+        if(status != nullptr)
+        {
+            getSharedModels().erase(modelPath);
+            Ort::ThrowOnError(status);
+        }
+
+        model.path = loadPath;
+        int fd = open(loadPath.c_str(), O_RDONLY);
+        struct stat st;
+        if(fd >= 0 && fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(data != MAP_FAILED)
+            {
+                model.data = data;
+                model.size = st.st_size;
+            }
+        }
+        if(fd >= 0)
+            close(fd);
+        if(model.data == nullptr)
+            printf("Warning: unable to map %s, loading it from the file system\n", loadPath.c_str());
+    }
+    model.refs++;
+    return model;
+}
+
+// call only once the sessions using the model are gone
+static void releaseSharedModel(const string& path)
+{
+    std::lock_guard<std::mutex> lock(sharedModelsMutex);
+    auto it = getSharedModels().find(path);
+    if(it == getSharedModels().end() || --it->second.refs > 0)
+        return;
+
+    if(it->second.data != nullptr)
+        munmap(it->second.data, it->second.size);
+    Ort::GetApi().ReleasePrepackedWeightsContainer(it->second.prepacked);
+    getSharedModels().erase(it);
+}
+
+// symbolic name of each axis of a node ("" where the model has none)
+static std::vector<string> symbolicNames(const Ort::ConstTensorTypeAndShapeInfo& tensorInfo)
+{
+    std::vector<const char*> names = tensorInfo.GetSymbolicDimensions();
+    std::vector<string> out;
+    for(const char* name : names)
+        out.push_back(name != nullptr ? name : "");
+    return out;
+}
+
+// ── Element type conversion ─────────────────────────────────────────────────
+// float <-> float16/int8/uint8 at the run() boundary. NEON on aarch64 (8 values
+// per step), plain loops elsewhere and for the tails
+
+static bool isSupportedType(ONNXTensorElementDataType type)
+{
+    return type == ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT || type == ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16 ||
+           type == ONNX_TENSOR_ELEMENT_DATA_TYPE_INT8  || type == ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8;
+}
+
+static size_t elementSize(ONNXTensorElementDataType type)
+{
+    switch(type)
+    {
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16: return 2;
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT8:
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8:   return 1;
+        default:                                    return sizeof(float);
+    }
+}
+
+static void floatToHalf(const float* src, uint16_t* dst, size_t n)
+{
+    size_t i = 0;
+#if defined(__aarch64__)
+    for(; i + 8 <= n; i += 8)
+    {
+        float16x8_t h = vcombine_f16(vcvt_f16_f32(vld1q_f32(src + i)), vcvt_f16_f32(vld1q_f32(src + i + 4)));
+        vst1q_u16(dst + i, vreinterpretq_u16_f16(h));
+    }
+#endif
+    for(; i < n; i++)
+        dst[i] = Ort::Float16_t(src[i]).val;
+}
+
+static void halfToFloat(const uint16_t* src, float* dst, size_t n)
+{
+    size_t i = 0;
+#if defined(__aarch64__)
+    for(; i + 8 <= n; i += 8)
+    {
+        float16x8_t h = vreinterpretq_f16_u16(vld1q_u16(src + i));
+        vst1q_f32(dst + i, vcvt_f32_f16(vget_low_f16(h)));
+        vst1q_f32(dst + i + 4, vcvt_high_f32_f16(h));
+    }
+#endif
+    for(; i < n; i++)
+        dst[i] = Ort::Float16_t::FromBits(src[i]).ToFloat();
+}
+
+template <typename T>
+static void quantize(const float* src, T* dst, size_t n, float scale, int32_t zeroPoint)
+{
+    const float invScale = 1.0f / scale;
+    const int32_t lo = std::numeric_limits<T>::min();
+    const int32_t hi = std::numeric_limits<T>::max();
+    size_t i = 0;
+#if defined(__aarch64__)
+    const float32x4_t vInvScale = vdupq_n_f32(invScale);
+    const int32x4_t vZeroPoint = vdupq_n_s32(zeroPoint);
+    for(; i + 8 <= n; i += 8)
+    {
+        // round to nearest even like QuantizeLinear, then saturate while narrowing
+        int32x4_t q0 = vaddq_s32(vcvtnq_s32_f32(vmulq_f32(vld1q_f32(src + i), vInvScale)), vZeroPoint);
+        int32x4_t q1 = vaddq_s32(vcvtnq_s32_f32(vmulq_f32(vld1q_f32(src + i + 4), vInvScale)), vZeroPoint);
+        int16x8_t q = vcombine_s16(vqmovn_s32(q0), vqmovn_s32(q1));
+        if(std::is_signed<T>::value)
+            vst1_s8((int8_t*)(dst + i), vqmovn_s16(q));
+        else
+            vst1_u8((uint8_t*)(dst + i), vqmovun_s16(q));
+    }
+#endif
+    for(; i < n; i++)
+    {
+        int32_t q = (int32_t)lrintf(src[i] * invScale) + zeroPoint;
+        dst[i] = (T)(q < lo ? lo : (q > hi ? hi : q));
+    }
+}
+
+template <typename T>
+static void dequantize(const T* src, float* dst, size_t n, float scale, int32_t zeroPoint)
+{
+    size_t i = 0;
+#if defined(__aarch64__)
+    const float32x4_t vScale = vdupq_n_f32(scale);
+    const int32x4_t vZeroPoint = vdupq_n_s32(zeroPoint);
+    for(; i + 8 <= n; i += 8)
+    {
+        int16x8_t q = std::is_signed<T>::value ? vmovl_s8(vld1_s8((const int8_t*)(src + i)))
+                                               : vreinterpretq_s16_u16(vmovl_u8(vld1_u8((const uint8_t*)(src + i))));
+        int32x4_t q0 = vsubq_s32(vmovl_s16(vget_low_s16(q)), vZeroPoint);
+        int32x4_t q1 = vsubq_s32(vmovl_high_s16(q), vZeroPoint);
+        vst1q_f32(dst + i, vmulq_f32(vcvtq_f32_s32(q0), vScale));
+        vst1q_f32(dst + i + 4, vmulq_f32(vcvtq_f32_s32(q1), vScale));
+    }
+#endif
+    for(; i < n; i++)
+        dst[i] = (float)((int32_t)src[i] - zeroPoint) * scale;
+}
+
 // this is taken from Domenico Stefani's OnnxTemplatePlugin
 // https://github.com/domenicostefani/ONNXruntime-VSTplugin-template.git
 template <typename T>
@@ -42,23 +286,119 @@ bool OrtModel::setup(string _sessionName, string _modelPath, bool _multiThreadin
     sessionOptions.EnableCpuMemArena();
     if(_multiThreading) 
     {
-        unsigned int max_threads = std::thread::hardware_concurrency();
-        sessionOptions.SetIntraOpNumThreads(max_threads);
+        // no pool of its own: all multithreaded sessions share the Env's
+        sessionOptions.DisablePerSessionThreads();
         if(verbose)
-            printf("Session %s, max thread: %d\n",  _sessionName.c_str(), max_threads);
+            printf("Session %s, on the global thread pool\n",  _sessionName.c_str());
+    }
+    else
+    {
+        // 1 = the calling thread only, no worker is spawned
+        sessionOptions.SetIntraOpNumThreads(1);
+        sessionOptions.SetInterOpNumThreads(1);
+    }
+    if(getRuntimeConfig().denormalsAsZero)
+        sessionOptions.AddConfigEntry(kOrtSessionOptionsConfigSetDenormalAsZero, "1");
+
+    // Use the optimized model cache if it is up to date, otherwise have ORT write
+    // it while optimizing the source model
+    string loadPath = _modelPath;
+    string cachePath = _modelPath + ".opt.ort";
+    string stampPath = cachePath + ".stamp";
+    string tmpPath = cachePath + ".tmp";
+    string stamp;
+    bool saveCache = false;
+    if(useModelCache)
+    {
+        ar::cache::Lookup cache = ar::cache::lookup(stampPath, modelCacheSettings(), _modelPath);
+        stamp = cache.stamp;
+        if(cache.upToDate)
+        {
+            // already optimized with ORT_ENABLE_ALL when it was saved
+            loadPath = cachePath;
+            sessionOptions.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_DISABLE_ALL);
+        }
+        else if(!stamp.empty())
+        {
+            sessionOptions.SetOptimizedModelFilePath(tmpPath.c_str());
+            sessionOptions.AddConfigEntry(kOrtSessionOptionsConfigSaveModelFormat, "ORT");
+            saveCache = true;
+        }
     }
 
     // Load Model
     try {
-        this->env = new Ort::Env(OrtLoggingLevel::ORT_LOGGING_LEVEL_WARNING, _sessionName.c_str());
-        this->session = new Ort::Session(*env, _modelPath.c_str(), sessionOptions);
+        if(useModelSharing)
+        {
+            SharedModel shared = acquireSharedModel(_modelPath, loadPath);
+            sharedModelPath = _modelPath;
+            if(shared.path != loadPath && shared.path == _modelPath)
+            {
+                // the others loaded the source model (e.g. while building the
+                // cache): share it, and optimize it again as they did
+                loadPath = _modelPath;
+                sessionOptions.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
+            }
+            if(shared.path != loadPath)
+            {
+                // the others use the cache, which is stale for us: the model changed
+                releaseSharedModel(sharedModelPath);
+                sharedModelPath.clear();
+                this->session = new Ort::Session(getEnv(), loadPath.c_str(), sessionOptions);
+            }
+            else if(shared.data != nullptr)
+            {
+                // the mapping outlives the session: ORT-format initializers can stay in it
+                if(loadPath == cachePath)
+                {
+                    sessionOptions.AddConfigEntry(kOrtSessionOptionsConfigUseORTModelBytesDirectly, "1");
+                    sessionOptions.AddConfigEntry(kOrtSessionOptionsConfigUseORTModelBytesForInitializers, "1");
+                }
+                this->session = new Ort::Session(getEnv(), shared.data, shared.size, sessionOptions, shared.prepacked);
+            }
+            else
+            {
+                this->session = new Ort::Session(getEnv(), loadPath.c_str(), sessionOptions, shared.prepacked);
+            }
+        }
+        else
+        {
+            this->session = new Ort::Session(getEnv(), loadPath.c_str(), sessionOptions);
+        }
         if(verbose)
-            printf("\nLoaded Model: %s\n", _modelPath.c_str());
+            printf("\nLoaded Model: %s%s\n", loadPath.c_str(), sharedModelPath.empty() ? "" : " (shared)");
     } catch (const Ort::Exception& exception) {
+        if(!sharedModelPath.empty())
+        {
+            releaseSharedModel(sharedModelPath);
+            sharedModelPath.clear();
+        }
+        if(loadPath == cachePath)
+        {
+            // drop the stamp so the retry rebuilds the cache from the source model
+            printf("Optimized model %s unusable (%s), rebuilding it\n", cachePath.c_str(), exception.what());
+            remove(stampPath.c_str());
+            return setup(_sessionName, _modelPath, _multiThreading);
+        }
+        remove(tmpPath.c_str());
         printf("Error loading model: %s\n", exception.what());
         return false;
     }
 
+    // ORT wrote the optimized model to tmpPath while creating the session
+    if(saveCache)
+    {
+        if(ar::cache::publish(tmpPath, cachePath, stampPath, stamp))
+        {
+            if(verbose)
+                printf("Saved optimized model: %s\n", cachePath.c_str());
+        }
+        else
+        {
+            printf("Warning: unable to save optimized model %s, it will be optimized again on next load\n", cachePath.c_str());
+        }
+    }
+
     // Get number of inputs/outputs to the model
     numInputNodes = this->session->GetInputCount();
     numOutputNodes = this->session->GetOutputCount();    
@@ -72,7 +412,9 @@ bool OrtModel::setup(string _sessionName, string _modelPath, bool _multiThreadin
 
     // allocate space to hold names of model inputs
     inputNodeNames.resize(numInputNodes);
-    inputNodeDims.resize(numInputNodes);
+    inputModelDims.resize(numInputNodes);
+    inputAxisNames.resize(numInputNodes);
+    inputTypes.resize(numInputNodes);
     // Gather metadata information about the model inputs
     for(int i = 0; i < numInputNodes; i++) {
     
@@ -93,31 +435,32 @@ bool OrtModel::setup(string _sessionName, string _modelPath, bool _multiThreadin
         ONNXTensorElementDataType type = tensorInfo.GetElementType();
         if(verbose)
             printf("Input %d : type=%d\n", i, type);
+        if(!isSupportedType(type))
+        {
+            printf("Input %d : unsupported element type %d (float, float16, int8, uint8 only)\n", i, type);
+            return false;
+        }
+        inputTypes[i] = type;
 
-        // Get shapes of input tensors
-        inputNodeDims[i] = tensorInfo.GetShape();
+        // Get shapes of input tensors, dynamic axes (<= 0) are sized in applyShapes()
+        inputModelDims[i] = tensorInfo.GetShape();
+        inputAxisNames[i] = symbolicNames(tensorInfo);
         if(verbose)
-            printf("Input %d : num_dims=%zu\n", i, inputNodeDims[i].size());
-        for(size_t j = 0; j < inputNodeDims[i].size(); j++) 
+            printf("Input %d : num_dims=%zu\n", i, inputModelDims[i].size());
+        for(size_t j = 0; j < inputModelDims[i].size(); j++) 
         {
             if(verbose)
-                printf("Input %d : dim %d=%d\n", i, (int)j, (int)inputNodeDims[i][j]);
-            if(inputNodeDims[i][j] <= 0) 
-            {
-                if(verbose)
-                    printf("Warning: Input %d, dim %d has non-positive size, adjusting to size of 1\n", i, (int)j);
-                inputNodeDims[i][j] = 1; // Adjust non-positive dimensions to 1
-            }
+                printf("Input %d : dim %d=%d%s%s\n", i, (int)j, (int)inputModelDims[i][j],
+                       inputAxisNames[i][j].empty() ? "" : " ", inputAxisNames[i][j].c_str());
         }
-
-        inputTensorSizes.push_back(vectorProduct(inputNodeDims[i]));
-        inputTensorValues.push_back(std::vector<float>(inputTensorSizes[i]));
     }
 
 
     // allocate space to hold names of model outputs
     outputNodeNames.resize(numOutputNodes);
-    outputNodeDims.resize(numOutputNodes);
+    outputModelDims.resize(numOutputNodes);
+    outputAxisNames.resize(numOutputNodes);
+    outputTypes.resize(numOutputNodes);
     // Gather metadata information about the model outputs
     for (int i = 0; i < numOutputNodes; i++) 
     { 
@@ -138,48 +481,329 @@ bool OrtModel::setup(string _sessionName, string _modelPath, bool _multiThreadin
         ONNXTensorElementDataType type = tensorInfo.GetElementType();
         if(verbose)
             printf("Output %d : type=%d\n", i, type);
+        if(!isSupportedType(type))
+        {
+            printf("Output %d : unsupported element type %d (float, float16, int8, uint8 only)\n", i, type);
+            return false;
+        }
+        outputTypes[i] = type;
 
-        // Get shapes of output tensors
-        outputNodeDims[i] = tensorInfo.GetShape();
+        // Get shapes of output tensors, dynamic axes (<= 0) are sized in applyShapes()
+        outputModelDims[i] = tensorInfo.GetShape();
+        outputAxisNames[i] = symbolicNames(tensorInfo);
         if(verbose)
-            printf("Output %d : num_dims=%zu\n", i, outputNodeDims[i].size());
-        for (int j = 0; j < outputNodeDims[i].size(); j++) {
+            printf("Output %d : num_dims=%zu\n", i, outputModelDims[i].size());
+        for (int j = 0; j < outputModelDims[i].size(); j++) {
             if(verbose)
-                printf("Output %d : dim %d=%d\n", i, j, (int)outputNodeDims[i][j]);
-            if ((int) this->outputNodeDims[i][j] < 0) {
-                if(verbose)
-                    printf("Output %d, dim %d has a variable size, forcing a size of 1", i,j);
-                outputNodeDims[i][j] = outputNodeDims[i][j]*-1;
-            }
+                printf("Output %d : dim %d=%d%s%s\n", i, j, (int)outputModelDims[i][j],
+                       outputAxisNames[i][j].empty() ? "" : " ", outputAxisNames[i][j].c_str());
         }
-
-        outputTensorSizes.push_back(vectorProduct(outputNodeDims[i]));
-        outputTensorValues.push_back(std::vector<float>(outputTensorSizes[i]));
     }
     if(verbose)
         printf("\n");
 
-    // Prepare in/out tensors
+    // Nothing bound yet, runBound() binds buffers on first use
+    for (int b = 0; b < 2; b++)
+    {
+        this->ioBindings[b] = new Ort::IoBinding(*session);
+        boundInputPtrs[b].assign(numInputNodes, nullptr);
+        boundOutputPtrs[b].assign(numOutputNodes, nullptr);
+        for (int i = 0; i < numInputNodes; i++)
+            boundInputTensors[b].emplace_back(nullptr);
+        for (int i = 0; i < numOutputNodes; i++)
+            boundOutputTensors[b].emplace_back(nullptr);
+    }
+
+    latency.reset();
+
+    // Default 8-bit mapping, [-1, 1) over the whole range
+    inputQuantization.resize(numInputNodes);
+    for (int i = 0; i < numInputNodes; i++)
+        inputQuantization[i] = {1.0f / 128.0f, inputTypes[i] == ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8 ? 128 : 0};
+    outputQuantization.resize(numOutputNodes);
+    for (int i = 0; i < numOutputNodes; i++)
+        outputQuantization[i] = {1.0f / 128.0f, outputTypes[i] == ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8 ? 128 : 0};
+
+    // Single voice until setBatchSize()
+    batchSize = 1;
+    voiceActive.assign(1, 1);
+    numActiveVoices = 1;
+
+    // No state until addState()
+    inputStates.assign(numInputNodes, -1);
+    outputStates.assign(numOutputNodes, -1);
+    stateParity = 0;
+    totalStateSize = 0;
+
+    // Concrete shapes, buffers and tensors
+    return applyShapes();
+}
+
+// Size of one model input axis: fixed, bound by name, bound by the catch-all, or 1
+int64_t OrtModel::axisSize(int64_t modelDim, const string& axisName) const
+{
+    if(modelDim > 0)
+        return modelDim;
+
+    auto it = dynamicAxes.find(axisName);
+    if(!axisName.empty() && it != dynamicAxes.end())
+        return it->second;
+    it = dynamicAxes.find("");
+    if(it != dynamicAxes.end())
+        return it->second;
+    return 1;
+}
+
+// (Re)build everything that depends on the concrete shapes: dims, sizes, the
+// run() buffers and tensors, state buffers; runBound() bindings are dropped
+bool OrtModel::applyShapes()
+{
+    inputNodeDims.resize(numInputNodes);
+    inputTensorSizes.clear();
+    inputTensorValues.clear();
+    inputNativeValues.clear();
+    inputTensors.clear();
     for (int i = 0; i < numInputNodes; i++) 
     {
-        inputTensors.push_back(Ort::Value::CreateTensor<float>(
-                                getMemoryInfo(),
-                                inputTensorValues[i].data(),
-                                inputTensorValues[i].size(),
-                                inputNodeDims[i].data(),
-                                inputNodeDims[i].size()));
+        inputNodeDims[i].resize(inputModelDims[i].size());
+        for(size_t j = 0; j < inputModelDims[i].size(); j++)
+            inputNodeDims[i][j] = axisSize(inputModelDims[i][j], inputAxisNames[i][j]);
+        if(batchSize > 1 && !inputNodeDims[i].empty())
+            inputNodeDims[i][0] = batchSize;
+
+        inputTensorSizes.push_back(vectorProduct(inputNodeDims[i]));
+        bool isFloat = inputTypes[i] == ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT;
+        inputTensorValues.push_back(std::vector<float>(isFloat ? inputTensorSizes[i] : 0));
+        inputNativeValues.push_back(std::vector<uint8_t>(isFloat ? 0 : inputTensorSizes[i] * elementSize(inputTypes[i])));
+        if(isFloat)
+            inputTensors.push_back(Ort::Value::CreateTensor<float>(
+                                    getMemoryInfo(),
+                                    inputTensorValues[i].data(),
+                                    inputTensorValues[i].size(),
+                                    inputNodeDims[i].data(),
+                                    inputNodeDims[i].size()));
+        else
+            inputTensors.push_back(Ort::Value::CreateTensor(
+                                    getMemoryInfo(),
+                                    inputNativeValues[i].data(),
+                                    inputNativeValues[i].size(),
+                                    inputNodeDims[i].data(),
+                                    inputNodeDims[i].size(),
+                                    inputTypes[i]));
+        // zero point, not 0, is silence for 8-bit nodes
+        copyInput(i, std::vector<float>(inputTensorSizes[i]).data());
     }
+
+    // Dynamic output axes are computed by the graph (unk__N, floor(N/2)...), so
+    // their sizes can't be told from the input bindings: one probe inference on
+    // the zeroed inputs gives the real output shapes
+    bool dynamicOutputs = false;
+    for (int i = 0; i < (int)numOutputNodes; i++)
+        for (int64_t dim : outputModelDims[i])
+            dynamicOutputs = dynamicOutputs || dim <= 0;
+    std::vector<Ort::Value> probe;
+    if(dynamicOutputs)
+    {
+        try {
+            probe = this->session->Run(
+                getRunOptions(),
+                inputNodeNames.data(),
+                inputTensors.data(),
+                inputTensors.size(),
+                outputNodeNames.data(),
+                numOutputNodes);
+        } catch (const Ort::Exception& exception) {
+            printf("Unable to size the outputs, probe inference failed: %s\n", exception.what());
+            return false;
+        }
+    }
+
+    outputNodeDims.resize(numOutputNodes);
+    outputTensorSizes.clear();
+    outputTensorValues.clear();
+    outputNativeValues.clear();
+    outputTensors.clear();
     for (int i = 0; i < numOutputNodes; i++) 
     {
-        outputTensors.push_back(Ort::Value::CreateTensor<float>(
-            getMemoryInfo(),
-            outputTensorValues[i].data(),
-            outputTensorValues[i].size(),
-            outputNodeDims[i].data(),
-            outputNodeDims[i].size()));
+        if(dynamicOutputs)
+        {
+            outputNodeDims[i] = probe[i].GetTensorTypeAndShapeInfo().GetShape();
+        }
+        else
+        {
+            outputNodeDims[i] = outputModelDims[i];
+            if(batchSize > 1 && !outputNodeDims[i].empty())
+                outputNodeDims[i][0] = batchSize;
+        }
+        if(verbose && dynamicOutputs)
+        {
+            printf("Output %d : shape", i);
+            for(int64_t dim : outputNodeDims[i])
+                printf(" %lld", (long long)dim);
+            printf("\n");
+        }
+
+        outputTensorSizes.push_back(vectorProduct(outputNodeDims[i]));
+        bool isFloat = outputTypes[i] == ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT;
+        outputTensorValues.push_back(std::vector<float>(isFloat ? outputTensorSizes[i] : 0));
+        outputNativeValues.push_back(std::vector<uint8_t>(isFloat ? 0 : outputTensorSizes[i] * elementSize(outputTypes[i])));
+        if(isFloat)
+            outputTensors.push_back(Ort::Value::CreateTensor<float>(
+                getMemoryInfo(),
+                outputTensorValues[i].data(),
+                outputTensorValues[i].size(),
+                outputNodeDims[i].data(),
+                outputNodeDims[i].size()));
+        else
+            outputTensors.push_back(Ort::Value::CreateTensor(
+                getMemoryInfo(),
+                outputNativeValues[i].data(),
+                outputNativeValues[i].size(),
+                outputNodeDims[i].data(),
+                outputNodeDims[i].size(),
+                outputTypes[i]));
+    }
+
+    // Bound tensors have the old shapes: rebind on the next runBound()
+    for (int b = 0; b < 2; b++)
+    {
+        ioBindings[b]->ClearBoundInputs();
+        ioBindings[b]->ClearBoundOutputs();
+        boundInputPtrs[b].assign(numInputNodes, nullptr);
+        boundOutputPtrs[b].assign(numOutputNodes, nullptr);
+        for (int i = 0; i < numInputNodes; i++)
+            boundInputTensors[b][i] = Ort::Value(nullptr);
+        for (int i = 0; i < numOutputNodes; i++)
+            boundOutputTensors[b][i] = Ort::Value(nullptr);
+    }
+
+    // States follow their tensors' new size and restart from zero
+    totalStateSize = 0;
+    for(size_t s = 0; s < states.size(); s++)
+    {
+        StateTensor& state = states[s];
+        if(inputTensorSizes[state.inputIdx] != outputTensorSizes[state.outputIdx])
+        {
+            printf("State size mismatch after reshape: output %d has %zu elements, input %d has %zu\n",
+                   state.outputIdx, outputTensorSizes[state.outputIdx], state.inputIdx, inputTensorSizes[state.inputIdx]);
+            return false;
+        }
+        freeBuffer(state.buffers[0]);
+        freeBuffer(state.buffers[1]);
+        state.size = inputTensorSizes[state.inputIdx];
+        state.buffers[0] = allocBuffer(state.size);
+        state.buffers[1] = allocBuffer(state.size);
+        if(state.buffers[0] == nullptr || state.buffers[1] == nullptr)
+        {
+            printf("Unable to allocate state buffers\n");
+            return false;
+        }
+        totalStateSize += state.size;
+    }
+    stateParity = 0;
+
+    return true;
+}
+
+bool OrtModel::setDynamicAxis(const string& axisName, int64_t size)
+{
+    if(size <= 0)
+    {
+        printf("Invalid size %lld for dynamic axis '%s'\n", (long long)size, axisName.c_str());
+        return false;
+    }
+    dynamicAxes[axisName] = size;
+
+    // before setup() the shapes are built there
+    if(session == nullptr)
+        return true;
+    return applyShapes();
+}
+
+bool OrtModel::setBatchSize(int n)
+{
+    if(session == nullptr || n < 1)
+    {
+        printf("Invalid batch size %d (or model not set up)\n", n);
+        return false;
+    }
+
+    // the batch axis must be free to take n, or already be n
+    if(n > 1)
+    {
+        for(int i = 0; i < numInputNodes; i++)
+        {
+            if(inputModelDims[i].empty() || (inputModelDims[i][0] > 0 && inputModelDims[i][0] != n))
+            {
+                printf("Input %d has no dynamic batch axis, can't batch %d voices\n", i, n);
+                return false;
+            }
+        }
+        for(int i = 0; i < numOutputNodes; i++)
+        {
+            if(outputModelDims[i].empty() || (outputModelDims[i][0] > 0 && outputModelDims[i][0] != n))
+            {
+                printf("Output %d has no dynamic batch axis, can't batch %d voices\n", i, n);
+                return false;
+            }
+        }
+    }
+
+    batchSize = n;
+    voiceActive.assign(n, 1);
+    numActiveVoices = n;
+    if(verbose)
+        printf("Batch of %d voices\n", n);
+    return applyShapes();
+}
+
+void OrtModel::setVoiceActive(int voice, bool active)
+{
+    if(voice < 0 || voice >= batchSize || (voiceActive[voice] != 0) == active)
+        return;
+    voiceActive[voice] = active ? 1 : 0;
+    numActiveVoices += active ? 1 : -1;
+}
+
+void OrtModel::resetVoiceState(int voice)
+{
+    for(size_t s = 0; s < states.size(); s++)
+    {
+        size_t voiceSize = states[s].size / batchSize;
+        memset(states[s].buffers[0] + voice * voiceSize, 0, voiceSize * sizeof(float));
+        memset(states[s].buffers[1] + voice * voiceSize, 0, voiceSize * sizeof(float));
     }
+}
 
-    return true;   
+// all voices in one run; the batch shape is fixed, so masking happens afterwards
+void OrtModel::runBatch(float** inputs, float** outputs)
+{
+    runBound(inputs, outputs);
+    if(numActiveVoices == batchSize)
+        return;
+
+    for(int v = 0; v < batchSize; v++)
+    {
+        if(voiceActive[v])
+            continue;
+
+        // silence
+        for(int i = 0; i < numOutputNodes; i++)
+        {
+            if(outputStates[i] >= 0)
+                continue;
+            size_t voiceSize = outputTensorSizes[i] / batchSize;
+            memset(outputs[i] + v * voiceSize, 0, voiceSize * sizeof(float));
+        }
+        // runBound() flipped the parity: carry over what this voice had before the run
+        for(size_t s = 0; s < states.size(); s++)
+        {
+            size_t voiceSize = states[s].size / batchSize;
+            memcpy(states[s].buffers[stateParity] + v * voiceSize,
+                   states[s].buffers[stateParity ^ 1] + v * voiceSize,
+                   voiceSize * sizeof(float));
+        }
+    }
 }
 
 // single input note
@@ -187,10 +811,10 @@ void OrtModel::run(float* input, float* output)
 {
     // Copy Inputs
     // Assume there is 1 input node 
-    for(int i = 0; i < inputTensorSizes[0]; i++) 
-        inputTensorValues[0][i] = input[i];
+    copyInput(0, input);
 
     // Run Inference
+    auto t0 = std::chrono::steady_clock::now();
     this->session->Run(
         getRunOptions(),
         inputNodeNames.data(),
@@ -199,10 +823,10 @@ void OrtModel::run(float* input, float* output)
         outputNodeNames.data(),
         outputTensors.data(),
         1);
+    logLatency(t0);
 
     // Copy Output
-    for( int i = 0; i < outputTensorSizes[0]; i++)
-        output[i] = outputTensorValues[0][i];
+    copyOutput(0, output);
 }
 
 // single input node + cond params
@@ -210,14 +834,13 @@ void OrtModel::run(float* input, float* params, float* output)
 {
     // Copy Inputs
     // Assume there is 1 input node 
-    for(int i = 0; i < inputTensorSizes[0]; i++)
-        inputTensorValues[0][i] = input[i];
+    copyInput(0, input);
 
     // Copy Conditioning params
-    for(int i = 0; i < inputTensorSizes[1]; i++)
-        inputTensorValues[1][i] = params[i];
+    copyInput(1, params);
 
     // Run Inference
+    auto t0 = std::chrono::steady_clock::now();
     this->session->Run(
         getRunOptions(),
         inputNodeNames.data(),
@@ -226,10 +849,10 @@ void OrtModel::run(float* input, float* params, float* output)
         outputNodeNames.data(),
         outputTensors.data(),
         1);
+    logLatency(t0);
 
     // Copy Output
-    for(int i = 0; i < outputTensorSizes[0]; i++)
-        output[i] = outputTensorValues[0][i];
+    copyOutput(0, output);
 }
 
 // multiple input nodes
@@ -237,12 +860,10 @@ void OrtModel::run(float** inputs, float* output)
 {
     // Copy Inputs
     for(int i = 0; i < numInputNodes; i++) 
-    {
-        for (int j = 0; j < inputTensorSizes[i]; j++)
-            inputTensorValues[i][j] = inputs[i][j];
-    }
+        copyInput(i, inputs[i]);
 
     // Run Inference
+    auto t0 = std::chrono::steady_clock::now();
     this->session->Run(
         getRunOptions(),
         inputNodeNames.data(),
@@ -251,10 +872,10 @@ void OrtModel::run(float** inputs, float* output)
         outputNodeNames.data(),
         outputTensors.data(),
         1);
+    logLatency(t0);
 
     // Copy Output
-    for(int i = 0; i < outputTensorSizes[0]; i++)
-        output[i] = outputTensorValues[0][i];
+    copyOutput(0, output);
 }
 
 // multiple input/output nodes
@@ -262,12 +883,10 @@ void OrtModel::run(float** inputs, float** outputs)
 {
     // Copy Inputs
     for(int i = 0; i < numInputNodes; i++) 
-    {
-        for (int j = 0; j < inputTensorSizes[i]; j++)
-            inputTensorValues[i][j] = inputs[i][j];
-    }
+        copyInput(i, inputs[i]);
 
     // Run Inference
+    auto t0 = std::chrono::steady_clock::now();
     this->session->Run(
         getRunOptions(),
         inputNodeNames.data(),
@@ -277,20 +896,341 @@ void OrtModel::run(float** inputs, float** outputs)
         outputTensors.data(),
         outputTensors.size()
         );
+    logLatency(t0);
 
     // Copy Outputs
     for(int i = 0; i < numOutputNodes; i++) 
+        copyOutput(i, outputs[i]);
+}
+
+void OrtModel::copyInput(int i, const float* src)
+{
+    size_t n = inputTensorSizes[i];
+    void* dst = inputNativeValues[i].data();
+    switch(inputTypes[i])
     {
-        for(int j = 0; j < outputTensorSizes[i]; j++) 
-            outputs[i][j] = outputTensorValues[i][j];
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16:
+            floatToHalf(src, (uint16_t*)dst, n);
+            break;
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT8:
+            quantize(src, (int8_t*)dst, n, inputQuantization[i].scale, inputQuantization[i].zeroPoint);
+            break;
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8:
+            quantize(src, (uint8_t*)dst, n, inputQuantization[i].scale, inputQuantization[i].zeroPoint);
+            break;
+        default:
+            memcpy(inputTensorValues[i].data(), src, n * sizeof(float));
+            break;
     }
 }
 
-void OrtModel::cleanup()
+void OrtModel::copyOutput(int i, float* dst)
+{
+    size_t n = outputTensorSizes[i];
+    const void* src = outputNativeValues[i].data();
+    switch(outputTypes[i])
+    {
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16:
+            halfToFloat((const uint16_t*)src, dst, n);
+            break;
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT8:
+            dequantize((const int8_t*)src, dst, n, outputQuantization[i].scale, outputQuantization[i].zeroPoint);
+            break;
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8:
+            dequantize((const uint8_t*)src, dst, n, outputQuantization[i].scale, outputQuantization[i].zeroPoint);
+            break;
+        default:
+            memcpy(dst, outputTensorValues[i].data(), n * sizeof(float));
+            break;
+    }
+}
+
+bool OrtModel::setInputQuantization(int i, float scale, int32_t zeroPoint)
+{
+    if(i < 0 || i >= (int)numInputNodes || scale <= 0.0f ||
+       (inputTypes[i] != ONNX_TENSOR_ELEMENT_DATA_TYPE_INT8 && inputTypes[i] != ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8))
+    {
+        printf("Input %d : not an 8-bit node or invalid scale %f\n", i, scale);
+        return false;
+    }
+    inputQuantization[i] = {scale, zeroPoint};
+    return true;
+}
+
+bool OrtModel::setOutputQuantization(int i, float scale, int32_t zeroPoint)
+{
+    if(i < 0 || i >= (int)numOutputNodes || scale <= 0.0f ||
+       (outputTypes[i] != ONNX_TENSOR_ELEMENT_DATA_TYPE_INT8 && outputTypes[i] != ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8))
+    {
+        printf("Output %d : not an 8-bit node or invalid scale %f\n", i, scale);
+        return false;
+    }
+    outputQuantization[i] = {scale, zeroPoint};
+    return true;
+}
+
+bool OrtModel::configureRuntime(const OrtRuntimeConfig& config)
+{
+    if(runtimeStarted)
+    {
+        printf("ONNX Runtime already started, configuration ignored\n");
+        return false;
+    }
+    getRuntimeConfig() = config;
+    return true;
+}
+
+// multiple input/output nodes, on caller buffers (and state buffers)
+void OrtModel::runBound(float** inputs, float** outputs)
+{
+    // With states, even runs use binding 0 and odd runs binding 1; each binding
+    // sees the same state buffers every time it is used
+    int b = stateParity;
+    Ort::IoBinding* ioBinding = ioBindings[b];
+
+    // Wrap and bind only the buffers that moved since this binding's last run;
+    // non-float nodes stay on their internal tensor, filled from the caller here
+    for(int i = 0; i < numInputNodes; i++)
+    {
+        if(inputTypes[i] != ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT)
+        {
+            copyInput(i, inputs[i]);
+            if(boundInputPtrs[b][i] == nullptr)
+            {
+                ioBinding->BindInput(inputNodeNames[i], inputTensors[i]);
+                boundInputPtrs[b][i] = (float*)inputNativeValues[i].data();
+            }
+            continue;
+        }
+        float* buffer = inputStates[i] >= 0 ? states[inputStates[i]].buffers[b] : inputs[i];
+        if(buffer != boundInputPtrs[b][i])
+        {
+            boundInputTensors[b][i] = Ort::Value::CreateTensor<float>(
+                getMemoryInfo(),
+                buffer,
+                inputTensorSizes[i],
+                inputNodeDims[i].data(),
+                inputNodeDims[i].size());
+            ioBinding->BindInput(inputNodeNames[i], boundInputTensors[b][i]);
+            boundInputPtrs[b][i] = buffer;
+        }
+    }
+    for(int i = 0; i < numOutputNodes; i++)
+    {
+        if(outputTypes[i] != ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT)
+        {
+            if(boundOutputPtrs[b][i] == nullptr)
+            {
+                ioBinding->BindOutput(outputNodeNames[i], outputTensors[i]);
+                boundOutputPtrs[b][i] = (float*)outputNativeValues[i].data();
+            }
+            continue;
+        }
+        float* buffer = outputStates[i] >= 0 ? states[outputStates[i]].buffers[b ^ 1] : outputs[i];
+        if(buffer != boundOutputPtrs[b][i])
+        {
+            boundOutputTensors[b][i] = Ort::Value::CreateTensor<float>(
+                getMemoryInfo(),
+                buffer,
+                outputTensorSizes[i],
+                outputNodeDims[i].data(),
+                outputNodeDims[i].size());
+            ioBinding->BindOutput(outputNodeNames[i], boundOutputTensors[b][i]);
+            boundOutputPtrs[b][i] = buffer;
+        }
+    }
+
+    // Run Inference, results land straight in the caller's output buffers
+    auto t0 = std::chrono::steady_clock::now();
+    this->session->Run(getRunOptions(), *ioBinding);
+    logLatency(t0);
+
+    for(int i = 0; i < numOutputNodes; i++)
+    {
+        if(outputTypes[i] != ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT)
+            copyOutput(i, outputs[i]);
+    }
+
+    // What was just written is what the next run reads
+    if(!states.empty())
+        stateParity ^= 1;
+}
+
+void OrtModel::logLatency(std::chrono::steady_clock::time_point start)
+{
+    if(!recordLatency)
+        return;
+    latency.record(std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start).count());
+}
+
+bool OrtModel::warmup(int n, float** inputs, float** outputs)
+{
+    if(this->session == nullptr)
+        return false;
+
+    // the first run of each binding is cold, keep it out of the stats
+    int coldRuns = (inputs != nullptr && !states.empty()) ? 2 : 1;
+
+    bool ok = true;
+    try {
+        for(int k = 0; k < n; k++)
+        {
+            recordLatency = k >= coldRuns;
+            if(inputs != nullptr)
+            {
+                runBound(inputs, outputs);
+            }
+            else
+            {
+                auto t0 = std::chrono::steady_clock::now();
+                this->session->Run(
+                    getRunOptions(),
+                    inputNodeNames.data(),
+                    inputTensors.data(),
+                    inputTensors.size(),
+                    outputNodeNames.data(),
+                    outputTensors.data(),
+                    outputTensors.size());
+                logLatency(t0);
+            }
+        }
+    } catch (const Ort::Exception& exception) {
+        printf("Error in warm-up inference: %s\n", exception.what());
+        ok = false;
+    }
+    recordLatency = true;
+
+    // the stream starts from scratch
+    resetState();
+    stateParity = 0;
+    return ok;
+}
+
+bool OrtModel::addState(int inputIdx, int outputIdx)
 {
+    if(inputIdx < 0 || inputIdx >= (int)numInputNodes || outputIdx < 0 || outputIdx >= (int)numOutputNodes)
+    {
+        printf("Invalid state mapping: output %d -> input %d\n", outputIdx, inputIdx);
+        return false;
+    }
+    if(inputStates[inputIdx] >= 0 || outputStates[outputIdx] >= 0)
+    {
+        printf("Input %d or output %d already used by a state\n", inputIdx, outputIdx);
+        return false;
+    }
+    if(inputTypes[inputIdx] != ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT || outputTypes[outputIdx] != ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT)
+    {
+        printf("Only float tensors can be states: output %d -> input %d\n", outputIdx, inputIdx);
+        return false;
+    }
+    if(inputTensorSizes[inputIdx] != outputTensorSizes[outputIdx])
+    {
+        printf("State size mismatch: output %d has %zu elements, input %d has %zu\n",
+               outputIdx, outputTensorSizes[outputIdx], inputIdx, inputTensorSizes[inputIdx]);
+        return false;
+    }
+
+    StateTensor state;
+    state.inputIdx = inputIdx;
+    state.outputIdx = outputIdx;
+    state.size = inputTensorSizes[inputIdx];
+    state.buffers[0] = allocBuffer(state.size);
+    state.buffers[1] = allocBuffer(state.size);
+    if(state.buffers[0] == nullptr || state.buffers[1] == nullptr)
+    {
+        printf("Unable to allocate state buffers\n");
+        freeBuffer(state.buffers[0]);
+        freeBuffer(state.buffers[1]);
+        return false;
+    }
+
+    inputStates[inputIdx] = (int)states.size();
+    outputStates[outputIdx] = (int)states.size();
+    states.push_back(state);
+    totalStateSize += state.size;
+
     if(verbose)
+        printf("State: output %d -> input %d (%zu elements)\n", outputIdx, inputIdx, state.size);
+    return true;
+}
+
+void OrtModel::resetState()
+{
+    for(size_t s = 0; s < states.size(); s++)
+    {
+        memset(states[s].buffers[0], 0, states[s].size * sizeof(float));
+        memset(states[s].buffers[1], 0, states[s].size * sizeof(float));
+    }
+}
+
+void OrtModel::snapshotState(float* dst) const
+{
+    for(size_t s = 0; s < states.size(); s++)
+    {
+        memcpy(dst, states[s].buffers[stateParity], states[s].size * sizeof(float));
+        dst += states[s].size;
+    }
+}
+
+void OrtModel::restoreState(const float* src)
+{
+    for(size_t s = 0; s < states.size(); s++)
+    {
+        memcpy(states[s].buffers[stateParity], src, states[s].size * sizeof(float));
+        src += states[s].size;
+    }
+}
+
+float* OrtModel::allocBuffer(size_t numElements)
+{
+    // aligned_alloc wants the size to be a multiple of the alignment
+    size_t bytes = numElements * sizeof(float);
+    bytes = (bytes + ORT_BUFFER_ALIGNMENT - 1) / ORT_BUFFER_ALIGNMENT * ORT_BUFFER_ALIGNMENT;
+    if(bytes == 0)
+        bytes = ORT_BUFFER_ALIGNMENT;
+
+    float* buffer = (float*)aligned_alloc(ORT_BUFFER_ALIGNMENT, bytes);
+    if(buffer != nullptr)
+        memset(buffer, 0, bytes);
+    return buffer;
+}
+
+void OrtModel::freeBuffer(float* buffer)
+{
+    free(buffer);
+}
+
+void OrtModel::cleanup()
+{
+    if(verbose && this->session != nullptr)
         printf("Cleanup ONNX session\n");
 
+    // Bindings reference the session, release them first
+    for (int b = 0; b < 2; b++)
+    {
+        if (this->ioBindings[b] != nullptr)
+        {
+            delete this->ioBindings[b];
+            this->ioBindings[b] = nullptr;
+        }
+        boundInputPtrs[b].clear();
+        boundOutputPtrs[b].clear();
+        boundInputTensors[b].clear();
+        boundOutputTensors[b].clear();
+    }
+
+    // State buffers
+    for (size_t s = 0; s < states.size(); s++)
+    {
+        freeBuffer(states[s].buffers[0]);
+        freeBuffer(states[s].buffers[1]);
+    }
+    states.clear();
+    inputStates.clear();
+    outputStates.clear();
+    stateParity = 0;
+    totalStateSize = 0;
+
     // Check if the session is initialized
     if (this->session != nullptr)
     {
@@ -299,11 +1239,23 @@ void OrtModel::cleanup()
         this->session = nullptr;
     }
 
+    // Model mapping and shared weights, once no session of ours uses them
+    if (!sharedModelPath.empty())
+    {
+        releaseSharedModel(sharedModelPath);
+        sharedModelPath.clear();
+    }
+
     // Clear out input-related vectors
     inputNodeNames.clear();
     inputNodeDims.clear();
+    inputModelDims.clear();
+    inputAxisNames.clear();
     inputTensorSizes.clear();
     inputTensorValues.clear();
+    inputNativeValues.clear();
+    inputTypes.clear();
+    inputQuantization.clear();
 
     // Clear tensors
     inputTensors.clear();
@@ -312,8 +1264,13 @@ void OrtModel::cleanup()
     // Clear output-related vectors
     outputNodeNames.clear();
     outputNodeDims.clear();
+    outputModelDims.clear();
+    outputAxisNames.clear();
     outputTensorSizes.clear();
     outputTensorValues.clear();
+    outputNativeValues.clear();
+    outputTypes.clear();
+    outputQuantization.clear();
 
     // Reset other member variables
     numInputNodes = 0;
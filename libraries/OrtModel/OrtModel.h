@@ -4,25 +4,157 @@
  */
 
 #include "onnxruntime_cxx_api.h"
+#include "LatencyLog.h"
 #include <string>
+#include <chrono>
+#include <map>
 
 using std::string;
 
+// Process-wide ONNX Runtime threading, shared by every OrtModel through a single
+// Ort::Env and its global thread pool (see OrtModel::configureRuntime)
+struct OrtRuntimeConfig {
+    int intraOpThreads = 0;        // global intra-op pool size, calling thread included; 0 = all cores
+    int interOpThreads = 1;        // global inter-op pool size (only used by parallel graph execution)
+    bool allowSpinning = true;     // pool threads spin-wait for work before sleeping (ORT default)
+    bool denormalsAsZero = false;  // flush-to-zero/denormals-are-zero in the pool threads
+    string intraOpAffinity;        // ORT affinity string for the intraOpThreads-1 workers
+                                   // (e.g. "6;7" pins two workers to cores 6 and 7); empty = unpinned
+};
+
 class OrtModel {
 public:
 
     OrtModel() {}
     OrtModel(bool _verbose) :  verbose(_verbose) {}
-    ~OrtModel() {}
+    ~OrtModel() { cleanup(); }
+
+    // owns the session and its buffers
+    OrtModel(const OrtModel&) = delete;
+    OrtModel& operator=(const OrtModel&) = delete;
 
+    // _multiThreading: run on the shared global pool; otherwise the session has no
+    // threads at all and inference runs entirely on the calling thread
     bool setup(string _sessionName, string _modelPath, bool _multiThreading=false);
+    // Releases the session, bindings, state buffers and the shared model. The
+    // destructor calls it too; calling it again does nothing. A global instance
+    // must call it before exit, while the ORT Env is still alive
     void cleanup();
+
+    // Binds the model's dynamic input axes (dims <= 0) to a fixed size, so e.g. a
+    // time axis covers a whole period per call: by symbolic name as exported (e.g.
+    // "time"), or with an empty name every dynamic axis not bound by name. Others
+    // stay 1. Output shapes are whatever the graph computes from the inputs: when
+    // they have dynamic axes, one probe inference finds them. Before setup() it
+    // sets the initial shapes; after it, all buffers and tensors are re-allocated,
+    // runBound() bindings dropped and states zeroed, so never call it from the
+    // audio thread and re-query the sizes afterwards
+    bool setDynamicAxis(const string& axisName, int64_t size);
+
+    // The graph optimized at first load is saved next to the model (<model>.opt.ort)
+    // and loaded directly on later setup() calls, skipping optimization; it is
+    // rebuilt when the model content or the ORT version changes (the model is only
+    // hashed when its size or mtime differ from the cache's). On by default, call
+    // before setup() to turn it off (e.g. read-only model directory)
+    void setModelCache(bool enable) { useModelCache = enable; }
+
+    // Instances loading the same model file share it: the file is mmap'd once and
+    // the kernels' pre-packed weights live in one Ort PrepackedWeightsContainer, so
+    // an extra instance only adds its activations and state. They share whichever
+    // of the source model and its optimized cache the first one loaded; with the
+    // cache (ORT format) the initializers are used in place from the mapping. On by
+    // default, call before setup() to give this instance private copies instead
+    void setModelSharing(bool enable) { useModelSharing = enable; }
+
+    // Set the process-wide runtime (OrtRuntimeConfig). Optional, but it must come
+    // before the first setup() of any instance: the Env and its pool are created
+    // then and can't be changed afterwards (returns false)
+    static bool configureRuntime(const OrtRuntimeConfig& config);
     
+    // All run() variants and runBound() take and return floats, whatever the node
+    // element types: float, float16, int8 and uint8 nodes are supported, converted
+    // at the boundary (see setInputQuantization for the 8-bit ones)
     void run(float* input, float* output); // single input note
     void run(float* input, float* params, float* output); // single input node + cond params
     void run(float** inputs, float* output); // multiple input nodes
     void run(float** inputs, float** outputs); // multiple input/output nodes
 
+    // ── Zero-copy I/O ────────────────────────────────────────────────────────
+    // Runs directly on caller-owned buffers, with no copy in or out: inputs[i] holds
+    // getInputSize(i) floats, outputs[i] getOutputSize(i). Buffers are bound to the
+    // session via Ort::IoBinding and a tensor is rebound (allocates) only when its
+    // pointer changed since the previous call, so keep buffers stable across calls.
+    // Non-float nodes can't be zero-copy: they stay bound to internal tensors and
+    // are converted from/to the caller's buffers around the run
+    void runBound(float** inputs, float** outputs);
+
+    // ── Reduced-precision nodes ──────────────────────────────────────────────
+    // Affine mapping of an int8/uint8 node: q = round(x / scale) + zeroPoint,
+    // saturated, and x = (q - zeroPoint) * scale. Defaults map [-1, 1) onto the
+    // whole range: scale 1/128 with zero point 0 (int8) or 128 (uint8). Use the
+    // values of the export's Quantize/DequantizeLinear. Returns false on float nodes
+    bool setInputQuantization(int i, float scale, int32_t zeroPoint);
+    bool setOutputQuantization(int i, float scale, int32_t zeroPoint);
+    ONNXTensorElementDataType getInputType(int i)  const { return inputTypes[i]; }
+    ONNXTensorElementDataType getOutputType(int i) const { return outputTypes[i]; }
+    // 64-byte aligned, zero-initialized I/O buffer, to release with freeBuffer()
+    static float* allocBuffer(size_t numElements);
+    static void freeBuffer(float* buffer);
+
+    // ── Stateful streaming ───────────────────────────────────────────────────
+    // Declares output outputIdx as the next value of input inputIdx (e.g. the caches
+    // of a streaming decoder). The model then owns two buffers for that state and
+    // swaps input/output roles after every runBound(), so the state is carried over
+    // without copies; inputs[inputIdx]/outputs[outputIdx] passed to runBound() are
+    // ignored (may be nullptr). States start zeroed. Call after setup(), not from
+    // the audio thread. Returns false on bad indices, mismatching sizes or
+    // non-float nodes
+    bool addState(int inputIdx, int outputIdx);
+    // Zero all states, e.g. to restart a stream
+    void resetState();
+    // Copy the current states (the ones the next runBound() reads), concatenated in
+    // addState() order, to/from a buffer of getStateSize() floats
+    size_t getStateSize() const { return totalStateSize; }
+    void snapshotState(float* dst) const;
+    void restoreState(const float* src);
+
+    // ── Batched voices ───────────────────────────────────────────────────────
+    // Runs n voices (or channels) of the same model in one Session::Run, along the
+    // first axis of every input and output, which must be dynamic or fixed to n.
+    // Each buffer then holds n contiguous voice slices of getInputSize(i)/n floats
+    // (getInputVoiceSize), voice v at offset v * that size; states are per voice
+    // too. Call after setup(), never from the audio thread: buffers, tensors and
+    // states are re-allocated as with setDynamicAxis()
+    bool setBatchSize(int n);
+    int getBatchSize() const { return batchSize; }
+    size_t getInputVoiceSize(int i)  const { return inputTensorSizes[i] / batchSize; }
+    size_t getOutputVoiceSize(int i) const { return outputTensorSizes[i] / batchSize; }
+    // All voices start active. Inactive ones are still computed (the batch shape is
+    // fixed) but their outputs come back zeroed and their states don't advance
+    void setVoiceActive(int voice, bool active);
+    bool isVoiceActive(int voice) const { return voiceActive[voice] != 0; }
+    // Zero the states of one voice only, e.g. on a new note
+    void resetVoiceState(int voice);
+    // runBound() over all voices, plus masking of the inactive ones
+    void runBatch(float** inputs, float** outputs);
+
+    // ── Warm-up & latency ────────────────────────────────────────────────────
+    using LatencyStats = ar::LatencyStats;
+    // Runs n inferences so arena growth, kernel selection and lazy init happen now
+    // rather than in the first audio period. Without buffers it runs on zeroed
+    // internal tensors; pass the ones later given to runBound() to also create its
+    // bindings here. States are reset afterwards. All runs but the cold one(s) are
+    // recorded, so getLatencyStats() right after tells whether the model fits
+    // the period budget. False if the model isn't set up or an inference fails
+    bool warmup(int n = 8, float** inputs = nullptr, float** outputs = nullptr);
+    // Every run()/runBound() inference is timed; stats cover the last latencyWindow
+    // calls. Computing them sorts a copy, so query outside the audio thread; that
+    // is safe while the audio thread runs (see LatencyLog.h)
+    static const size_t latencyWindow = ar::LatencyLog::window;
+    LatencyStats getLatencyStats() const { return latency.stats(); }
+    // not while the audio thread runs the model
+    void resetLatencyStats() { latency.reset(); }
+
     // ── Accessors for buffer allocation ──────────────────────────────────────
     size_t getNumInputs()  const { return numInputNodes; }
     size_t getNumOutputs() const { return numOutputNodes; }
@@ -31,9 +163,13 @@ public:
 
 private: 
     bool verbose = true;
+    bool useModelCache = true;
+    bool useModelSharing = true;
+    // file shared with the other instances, released in cleanup() (see setModelSharing)
+    string sharedModelPath;
 
     // Holds onnx runtime session object, everything needed to interface with model
-    Ort::Env * env = nullptr;
+    // (the Ort::Env is shared by all instances)
     Ort::Session * session = nullptr;
 
     // Path to ONNX Model file
@@ -45,24 +181,84 @@ private:
     size_t numInputNodes = 0;
     // Names of each of the inputs to the model
     std::vector<const char*> inputNodeNames;
-    // Tensor Dimensions of each input
+    // Tensor Dimensions of each input, as in the model (<= 0 = dynamic) and bound
+    std::vector<std::vector<int64_t>> inputModelDims;
+    std::vector<std::vector<string>> inputAxisNames;
     std::vector<std::vector<int64_t>> inputNodeDims;
     // Aggregated tensor size for each input
     std::vector<size_t> inputTensorSizes;
+    // Element type of each input
+    std::vector<ONNXTensorElementDataType> inputTypes;
 
     // Number of outputs to the model
     size_t numOutputNodes = 0;
     // Names of each of the outputs to the model
     std::vector<const char*> outputNodeNames;
-    // Tensor Dimensions of each output 
+    // Tensor Dimensions of each output, as in the model (<= 0 = dynamic) and bound
+    std::vector<std::vector<int64_t>> outputModelDims;
+    std::vector<std::vector<string>> outputAxisNames;
     std::vector<std::vector<int64_t>> outputNodeDims;
     // Aggregated tensor size for each output
     std::vector<size_t> outputTensorSizes;
+    // Element type of each output
+    std::vector<ONNXTensorElementDataType> outputTypes;
 
-    // Tensors
+    // Tensors: float nodes live in *TensorValues, the others in *NativeValues in
+    // their own element type (the unused one of the two is empty)
     std::vector<std::vector<float>> inputTensorValues;
     std::vector<std::vector<float>> outputTensorValues;
+    std::vector<std::vector<uint8_t>> inputNativeValues;
+    std::vector<std::vector<uint8_t>> outputNativeValues;
     std::vector<Ort::Value> inputTensors;
     std::vector<Ort::Value> outputTensors;
+
+    // int8/uint8 node mapping (see setInputQuantization)
+    struct Quantization {
+        float scale;
+        int32_t zeroPoint;
+    };
+    std::vector<Quantization> inputQuantization;
+    std::vector<Quantization> outputQuantization;
+
+    // float <-> tensor element type, from/to the caller's buffers
+    void copyInput(int i, const float* src);
+    void copyOutput(int i, float* dst);
+
+    // Buffers currently bound for runBound(), and their tensors. There is one
+    // binding per state parity, so swapping states never rebinds anything
+    Ort::IoBinding * ioBindings[2] = {nullptr, nullptr};
+    std::vector<float*> boundInputPtrs[2];
+    std::vector<float*> boundOutputPtrs[2];
+    std::vector<Ort::Value> boundInputTensors[2];
+    std::vector<Ort::Value> boundOutputTensors[2];
+
+    // State tensors (see addState): buffers[stateParity] is read by the next run,
+    // buffers[!stateParity] written by it
+    struct StateTensor {
+        int inputIdx;
+        int outputIdx;
+        size_t size;
+        float* buffers[2];
+    };
+    std::vector<StateTensor> states;
+    std::vector<int> inputStates;  // per input node, index in states or -1
+    std::vector<int> outputStates; // per output node, index in states or -1
+    int stateParity = 0;
+    size_t totalStateSize = 0;
+
+    // Batched voices (see setBatchSize): the first axis of all nodes
+    int batchSize = 1;
+    std::vector<uint8_t> voiceActive;
+    int numActiveVoices = 1;
+
+    // Sizes of the dynamic axes by symbolic name, "" = any (see setDynamicAxis)
+    std::map<string, int64_t> dynamicAxes;
+    int64_t axisSize(int64_t modelDim, const string& axisName) const;
+    bool applyShapes();
+
+    // Inference latency ring (see getLatencyStats)
+    ar::LatencyLog latency;
+    bool recordLatency = true;
+    void logLatency(std::chrono::steady_clock::time_point start);
     
 };
\ No newline at end of file
@@ -12,15 +12,37 @@
 //   .dlc -> composed at load via QnnSystemDlc_composeGraphs (+ graph finalize)
 //   .bin -> precompiled context binary via QnnContext_createFromBinary (no finalize)
 // Both paths converge on the same graph-retrieve / tensor-setup / execute code.
+// A composed .dlc context is cached as a context binary (QnnContext_getBinary),
+// which later loads take the .bin path with.
 
 #include "QnnModel.h"
+#include "ModelCache.h"
 
 #include <dlfcn.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
 #include <cstdarg>
 #include <cstdint>
 #include <cstdio>
 #include <cstring>
+#include <limits>
+#include <map>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#endif
 
 #include "QnnInterface.h"
 #include "QnnTypes.h"
@@ -78,6 +100,10 @@ namespace ar
             {
                 return t.version == QNN_TENSOR_VERSION_1 ? t.v1.dataType : t.v2.dataType;
             }
+            const Qnn_QuantizeParams_t &tensorQuantizeParams(const Qnn_Tensor_t &t)
+            {
+                return t.version == QNN_TENSOR_VERSION_1 ? t.v1.quantizeParams : t.v2.quantizeParams;
+            }
             const char *tensorName(const Qnn_Tensor_t &t)
             {
                 const char *n = t.version == QNN_TENSOR_VERSION_1 ? t.v1.name : t.v2.name;
@@ -163,35 +189,332 @@ namespace ar
                 return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
             }
 
-            bool readFile(const std::string &path, std::vector<uint8_t> &out)
+            // read-only view of a whole file. Mapped private + writable so an API
+            // taking a non-const buffer can't fault; pages are only copied if written.
+            struct MappedFile
+            {
+                uint8_t *data = nullptr;
+                size_t size = 0;
+
+                MappedFile() = default;
+                MappedFile(const MappedFile &) = delete;
+                MappedFile &operator=(const MappedFile &) = delete;
+                ~MappedFile() { unmap(); }
+
+                bool map(const std::string &path)
+                {
+                    unmap();
+                    int fd = open(path.c_str(), O_RDONLY);
+                    if (fd < 0)
+                        return false;
+                    struct stat st;
+                    if (fstat(fd, &st) == 0 && st.st_size > 0)
+                    {
+                        void *p = mmap(nullptr, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+                        if (p != MAP_FAILED)
+                        {
+                            data = (uint8_t *)p;
+                            size = (size_t)st.st_size;
+                            madvise(p, size, MADV_SEQUENTIAL); // read once, front to back
+                        }
+                    }
+                    close(fd);
+                    return data != nullptr;
+                }
+
+                void unmap()
+                {
+                    if (data)
+                        munmap(data, size);
+                    data = nullptr;
+                    size = 0;
+                }
+            };
+
+            bool writeFile(const std::string &path, const void *data, size_t size)
             {
-                FILE *f = fopen(path.c_str(), "rb");
+                FILE *f = fopen(path.c_str(), "wb");
                 if (!f)
                     return false;
-                fseek(f, 0, SEEK_END);
-                long n = ftell(f);
-                fseek(f, 0, SEEK_SET);
-                if (n <= 0)
+                size_t wr = fwrite(data, 1, size, f);
+                return fclose(f) == 0 && wr == size;
+            }
+
+            // ----- context binary cache ------------------------------------------
+            // <dlc>.<backend lib>.ctx.bin holds the context serialized after compose +
+            // finalize; <...>.stamp records what it was built from (see ModelCache.h).
+            // The build settings are the backend library, with its size and mtime.
+
+            std::string contextCachePath(const std::string &dlcPath, const std::string &backendLibPath)
+            {
+                std::string lib = backendLibPath.substr(backendLibPath.find_last_of('/') + 1);
+                lib = lib.substr(0, lib.find('.'));
+                return dlcPath + "." + lib + ".ctx.bin";
+            }
+
+            // "" if the backend library can't be stat'd: no cache then
+            std::string contextCacheSettings(const std::string &backendLibPath)
+            {
+                struct stat lib;
+                if (stat(backendLibPath.c_str(), &lib) != 0)
+                    return "";
+
+                char settings[512];
+                snprintf(settings, sizeof(settings), "backend %s %lld %lld\n",
+                         backendLibPath.c_str(), (long long)lib.st_size, (long long)lib.st_mtime);
+                return settings;
+            }
+
+            // ----- float32 <-> native element conversion -----------------------
+            // fixed point: real = (q + offset) * scale, q = round(real / scale) - offset
+            // (saturated). NEON on aarch64, 8 elements per step; scalar tails/fallback.
+
+            bool elementTypeOf(Qnn_DataType_t dt, ElementType *type)
+            {
+                switch (dt)
                 {
-                    fclose(f);
-                    return false;
+                case QNN_DATATYPE_FLOAT_32:        *type = ElementType::Float32;  return true;
+                case QNN_DATATYPE_FLOAT_16:        *type = ElementType::Float16;  return true;
+                case QNN_DATATYPE_UFIXED_POINT_8:  *type = ElementType::UFixed8;  return true;
+                case QNN_DATATYPE_SFIXED_POINT_8:  *type = ElementType::SFixed8;  return true;
+                case QNN_DATATYPE_UFIXED_POINT_16: *type = ElementType::UFixed16; return true;
+                case QNN_DATATYPE_SFIXED_POINT_16: *type = ElementType::SFixed16; return true;
+                default:                           return false;
+                }
+            }
+
+            size_t elementBytes(ElementType type)
+            {
+                switch (type)
+                {
+                case ElementType::UFixed8:
+                case ElementType::SFixed8:  return 1;
+                case ElementType::Float16:
+                case ElementType::UFixed16:
+                case ElementType::SFixed16: return 2;
+                default:                    return 4;
+                }
+            }
+
+            // IEEE binary16 <-> binary32, round to nearest even (non-NEON path)
+            uint16_t floatToHalfBits(float f)
+            {
+                uint32_t x;
+                memcpy(&x, &f, sizeof(x));
+                const uint32_t sign = (x >> 16) & 0x8000;
+                const uint32_t biased = (x >> 23) & 0xff;
+                uint32_t mant = x & 0x7fffff;
+                if (biased == 0xff)
+                    return (uint16_t)(sign | 0x7c00 | (mant ? 0x200 : 0)); // inf/nan
+                const int32_t exp = (int32_t)biased - 127 + 15;
+                if (exp >= 31)
+                    return (uint16_t)(sign | 0x7c00); // overflow -> inf
+                if (exp <= 0)
+                {
+                    // subnormal (or zero) in half precision
+                    if (exp < -10)
+                        return (uint16_t)sign;
+                    mant |= 0x800000;
+                    const uint32_t shift = (uint32_t)(14 - exp);
+                    uint32_t h = mant >> shift;
+                    const uint32_t rem = mant & ((1u << shift) - 1);
+                    const uint32_t halfway = 1u << (shift - 1);
+                    if (rem > halfway || (rem == halfway && (h & 1)))
+                        ++h;
+                    return (uint16_t)(sign | h);
+                }
+                uint32_t h = ((uint32_t)exp << 10) | (mant >> 13);
+                const uint32_t rem = mant & 0x1fff;
+                if (rem > 0x1000 || (rem == 0x1000 && (h & 1)))
+                    ++h; // a carry into the exponent rounds up to the next binade/inf
+                return (uint16_t)(sign | h);
+            }
+
+            float halfBitsToFloat(uint16_t h)
+            {
+                const uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+                uint32_t exp = (h >> 10) & 0x1f;
+                uint32_t mant = h & 0x3ff;
+                uint32_t x;
+                if (exp == 0)
+                {
+                    if (mant == 0)
+                        x = sign;
+                    else
+                    {
+                        // subnormal: normalize
+                        exp = 127 - 15 + 1;
+                        while (!(mant & 0x400))
+                        {
+                            mant <<= 1;
+                            --exp;
+                        }
+                        x = sign | (exp << 23) | ((mant & 0x3ff) << 13);
+                    }
+                }
+                else if (exp == 31)
+                    x = sign | 0x7f800000 | (mant << 13);
+                else
+                    x = sign | ((exp - 15 + 127) << 23) | (mant << 13);
+                float f;
+                memcpy(&f, &x, sizeof(f));
+                return f;
+            }
+
+            void floatToHalf(const float *src, uint16_t *dst, size_t n)
+            {
+                size_t i = 0;
+#if defined(__aarch64__)
+                for (; i + 8 <= n; i += 8)
+                {
+                    float16x8_t h = vcombine_f16(vcvt_f16_f32(vld1q_f32(src + i)), vcvt_f16_f32(vld1q_f32(src + i + 4)));
+                    vst1q_u16(dst + i, vreinterpretq_u16_f16(h));
+                }
+#endif
+                for (; i < n; ++i)
+                    dst[i] = floatToHalfBits(src[i]);
+            }
+
+            void halfToFloat(const uint16_t *src, float *dst, size_t n)
+            {
+                size_t i = 0;
+#if defined(__aarch64__)
+                for (; i + 8 <= n; i += 8)
+                {
+                    float16x8_t h = vreinterpretq_f16_u16(vld1q_u16(src + i));
+                    vst1q_f32(dst + i, vcvt_f32_f16(vget_low_f16(h)));
+                    vst1q_f32(dst + i + 4, vcvt_high_f32_f16(h));
+                }
+#endif
+                for (; i < n; ++i)
+                    dst[i] = halfBitsToFloat(src[i]);
+            }
+
+#if defined(__aarch64__)
+            // 8 fixed-point values <-> two int32x4, saturating on the way down
+            inline void loadWide(const uint8_t *s, int32x4_t &lo, int32x4_t &hi)
+            {
+                uint16x8_t w = vmovl_u8(vld1_u8(s));
+                lo = vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(w)));
+                hi = vreinterpretq_s32_u32(vmovl_high_u16(w));
+            }
+            inline void loadWide(const int8_t *s, int32x4_t &lo, int32x4_t &hi)
+            {
+                int16x8_t w = vmovl_s8(vld1_s8(s));
+                lo = vmovl_s16(vget_low_s16(w));
+                hi = vmovl_high_s16(w);
+            }
+            inline void loadWide(const uint16_t *s, int32x4_t &lo, int32x4_t &hi)
+            {
+                uint16x8_t w = vld1q_u16(s);
+                lo = vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(w)));
+                hi = vreinterpretq_s32_u32(vmovl_high_u16(w));
+            }
+            inline void loadWide(const int16_t *s, int32x4_t &lo, int32x4_t &hi)
+            {
+                int16x8_t w = vld1q_s16(s);
+                lo = vmovl_s16(vget_low_s16(w));
+                hi = vmovl_high_s16(w);
+            }
+            inline void storeNarrow(uint8_t *d, int32x4_t lo, int32x4_t hi)
+            {
+                vst1_u8(d, vqmovun_s16(vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi))));
+            }
+            inline void storeNarrow(int8_t *d, int32x4_t lo, int32x4_t hi)
+            {
+                vst1_s8(d, vqmovn_s16(vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi))));
+            }
+            inline void storeNarrow(uint16_t *d, int32x4_t lo, int32x4_t hi)
+            {
+                vst1q_u16(d, vcombine_u16(vqmovun_s32(lo), vqmovun_s32(hi)));
+            }
+            inline void storeNarrow(int16_t *d, int32x4_t lo, int32x4_t hi)
+            {
+                vst1q_s16(d, vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+            }
+#endif
+
+            template <typename T>
+            void quantize(const float *src, T *dst, size_t n, float scale, int32_t offset)
+            {
+                const float invScale = 1.f / scale;
+                const int32_t lo = std::numeric_limits<T>::min();
+                const int32_t hi = std::numeric_limits<T>::max();
+                size_t i = 0;
+#if defined(__aarch64__)
+                const float32x4_t vInvScale = vdupq_n_f32(invScale);
+                const int32x4_t vOffset = vdupq_n_s32(offset);
+                for (; i + 8 <= n; i += 8)
+                {
+                    // round to nearest even, like the backend's own quantization
+                    int32x4_t q0 = vsubq_s32(vcvtnq_s32_f32(vmulq_f32(vld1q_f32(src + i), vInvScale)), vOffset);
+                    int32x4_t q1 = vsubq_s32(vcvtnq_s32_f32(vmulq_f32(vld1q_f32(src + i + 4), vInvScale)), vOffset);
+                    storeNarrow(dst + i, q0, q1);
+                }
+#endif
+                for (; i < n; ++i)
+                {
+                    int32_t q = (int32_t)lrintf(src[i] * invScale) - offset;
+                    dst[i] = (T)(q < lo ? lo : (q > hi ? hi : q));
+                }
+            }
+
+            template <typename T>
+            void dequantize(const T *src, float *dst, size_t n, float scale, int32_t offset)
+            {
+                size_t i = 0;
+#if defined(__aarch64__)
+                const float32x4_t vScale = vdupq_n_f32(scale);
+                const int32x4_t vOffset = vdupq_n_s32(offset);
+                for (; i + 8 <= n; i += 8)
+                {
+                    int32x4_t q0, q1;
+                    loadWide(src + i, q0, q1);
+                    vst1q_f32(dst + i, vmulq_f32(vcvtq_f32_s32(vaddq_s32(q0, vOffset)), vScale));
+                    vst1q_f32(dst + i + 4, vmulq_f32(vcvtq_f32_s32(vaddq_s32(q1, vOffset)), vScale));
+                }
+#endif
+                for (; i < n; ++i)
+                    dst[i] = (float)((int32_t)src[i] + offset) * scale;
+            }
+
+            void toNative(const TensorInfo &info, const float *src, void *dst)
+            {
+                const size_t n = info.numElements;
+                switch (info.type)
+                {
+                case ElementType::Float16:  floatToHalf(src, (uint16_t *)dst, n); break;
+                case ElementType::UFixed8:  quantize(src, (uint8_t *)dst, n, info.scale, info.offset); break;
+                case ElementType::SFixed8:  quantize(src, (int8_t *)dst, n, info.scale, info.offset); break;
+                case ElementType::UFixed16: quantize(src, (uint16_t *)dst, n, info.scale, info.offset); break;
+                case ElementType::SFixed16: quantize(src, (int16_t *)dst, n, info.scale, info.offset); break;
+                default:                    memcpy(dst, src, n * sizeof(float)); break;
+                }
+            }
+
+            void fromNative(const TensorInfo &info, const void *src, float *dst)
+            {
+                const size_t n = info.numElements;
+                switch (info.type)
+                {
+                case ElementType::Float16:  halfToFloat((const uint16_t *)src, dst, n); break;
+                case ElementType::UFixed8:  dequantize((const uint8_t *)src, dst, n, info.scale, info.offset); break;
+                case ElementType::SFixed8:  dequantize((const int8_t *)src, dst, n, info.scale, info.offset); break;
+                case ElementType::UFixed16: dequantize((const uint16_t *)src, dst, n, info.scale, info.offset); break;
+                case ElementType::SFixed16: dequantize((const int16_t *)src, dst, n, info.scale, info.offset); break;
+                default:                    memcpy(dst, src, n * sizeof(float)); break;
                 }
-                out.resize((size_t)n);
-                size_t rd = fread(out.data(), 1, (size_t)n, f);
-                fclose(f);
-                return rd == (size_t)n;
             }
 
         } // namespace
 
         // =====================================================================
-        // Impl
+        // QnnRuntime
         // =====================================================================
 
-        struct QnnModel::Impl
+        struct QnnRuntime::Impl
         {
             std::string backendLibPath;
-            std::string modelPath;
             std::string systemLibPath;
 
             void *backendLib = nullptr;
@@ -201,70 +524,31 @@ namespace ar
 
             Qnn_LogHandle_t logHandle = nullptr;
             Qnn_BackendHandle_t backend = nullptr;
-            Qnn_ContextHandle_t context = nullptr;
-
-            // .dlc source
-            QnnSystemDlc_Handle_t dlc = nullptr;
-            QnnSystemContext_GraphInfo_t *dlcGraphs = nullptr; // owned by us; free() at teardown
-
-            // .bin source
-            QnnSystemContext_Handle_t sysCtx = nullptr; // owns the BinaryInfo (+ its tensors/dims)
-            std::vector<uint8_t> binaryBuffer;
-
-            uint32_t numGraphs = 0;
-
-            std::vector<Qnn_GraphHandle_t> graphHandles;
-            std::vector<std::vector<TensorInfo>> inInfos;
-            std::vector<std::vector<TensorInfo>> outInfos;
-            std::vector<std::vector<Qnn_Tensor_t>> inTensors;
-            std::vector<std::vector<Qnn_Tensor_t>> outTensors;
 
-            bool loaded = false;
+            std::mutex initMutex;
+            bool initialized = false;
 
-            ~Impl() { teardown(); }
-            void teardown();
+            ~Impl() { release(); }
+            bool init(int logLevel);
+            void release();
         };
 
-        void QnnModel::Impl::teardown()
+        // models hold the runtime, so by the destructor every context on the
+        // backend is gone; init() also calls this to undo a partial init
+        void QnnRuntime::Impl::release()
         {
             if (iface)
             {
                 auto &core = iface->QNN_INTERFACE_VER_NAME;
-                if (context && core.contextFree)
-                    core.contextFree(context, nullptr);
                 if (backend && core.backendFree)
                     core.backendFree(backend);
                 if (logHandle && core.logFree)
                     core.logFree(logHandle);
             }
-            context = nullptr;
             backend = nullptr;
             logHandle = nullptr;
-
-            if (sysIface)
-            {
-                auto &sys = sysIface->QNN_SYSTEM_INTERFACE_VER_NAME;
-                if (dlc && sys.systemDlcFree)
-                    sys.systemDlcFree(dlc);
-                if (sysCtx && sys.systemContextFree)
-                    sys.systemContextFree(sysCtx); // frees the BinaryInfo it owns
-            }
-            dlc = nullptr;
-            sysCtx = nullptr;
-
-            if (dlcGraphs)
-            {
-                free(dlcGraphs); // composeGraphs: "Memory allocated in graphs is owned by clients"
-                dlcGraphs = nullptr;
-            }
-            numGraphs = 0;
-
-            graphHandles.clear();
-            inInfos.clear();
-            outInfos.clear();
-            inTensors.clear();
-            outTensors.clear();
-            binaryBuffer.clear();
+            iface = nullptr;
+            sysIface = nullptr;
 
             if (systemLib)
             {
@@ -276,52 +560,21 @@ namespace ar
                 dlclose(backendLib);
                 backendLib = nullptr;
             }
-            iface = nullptr;
-            sysIface = nullptr;
-            loaded = false;
-        }
-
-        // =====================================================================
-        // QnnModel
-        // =====================================================================
-
-        QnnModel::QnnModel(std::string backendLibPath, std::string modelPath, std::string systemLibPath)
-            : p_(new Impl())
-        {
-            p_->backendLibPath = std::move(backendLibPath);
-            p_->modelPath = std::move(modelPath);
-            p_->systemLibPath = std::move(systemLibPath);
+            initialized = false;
         }
 
-        QnnModel::~QnnModel() = default;
-
-        bool QnnModel::load(int logLevel)
+        bool QnnRuntime::Impl::init(int logLevel)
         {
-            if (p_->loaded)
-                return true;
-
-            // choose the source format from the file extension
-            bool isBinary;
-            if (endsWith(p_->modelPath, ".bin"))
-                isBinary = true;
-            else if (endsWith(p_->modelPath, ".dlc"))
-                isBinary = false;
-            else
-            {
-                logMsg("unknown model format for '%s' (expected .dlc or .bin)", p_->modelPath.c_str());
-                return false;
-            }
-
             // --- resolve the backend interface -------------------------------
-            p_->backendLib = dlopen(p_->backendLibPath.c_str(), RTLD_NOW | RTLD_LOCAL);
-            if (!p_->backendLib)
+            backendLib = dlopen(backendLibPath.c_str(), RTLD_NOW | RTLD_LOCAL);
+            if (!backendLib)
             {
-                logMsg("dlopen backend '%s' failed: %s", p_->backendLibPath.c_str(), dlerror());
+                logMsg("dlopen backend '%s' failed: %s", backendLibPath.c_str(), dlerror());
                 return false;
             }
             {
                 typedef Qnn_ErrorHandle_t (*GetProvidersFn)(const QnnInterface_t ***, uint32_t *);
-                auto getProviders = (GetProvidersFn)dlsym(p_->backendLib, "QnnInterface_getProviders");
+                auto getProviders = (GetProvidersFn)dlsym(backendLib, "QnnInterface_getProviders");
                 if (!getProviders)
                 {
                     logMsg("backend missing QnnInterface_getProviders: %s", dlerror());
@@ -334,19 +587,19 @@ namespace ar
                     logMsg("QnnInterface_getProviders returned no providers");
                     return false;
                 }
-                p_->iface = providers[0];
+                iface = providers[0];
             }
 
             // --- resolve the system interface --------------------------------
-            p_->systemLib = dlopen(p_->systemLibPath.c_str(), RTLD_NOW | RTLD_LOCAL);
-            if (!p_->systemLib)
+            systemLib = dlopen(systemLibPath.c_str(), RTLD_NOW | RTLD_LOCAL);
+            if (!systemLib)
             {
-                logMsg("dlopen system lib '%s' failed: %s", p_->systemLibPath.c_str(), dlerror());
+                logMsg("dlopen system lib '%s' failed: %s", systemLibPath.c_str(), dlerror());
                 return false;
             }
             {
                 typedef Qnn_ErrorHandle_t (*GetSysProvidersFn)(const QnnSystemInterface_t ***, uint32_t *);
-                auto getProviders = (GetSysProvidersFn)dlsym(p_->systemLib, "QnnSystemInterface_getProviders");
+                auto getProviders = (GetSysProvidersFn)dlsym(systemLib, "QnnSystemInterface_getProviders");
                 if (!getProviders)
                 {
                     logMsg("system lib missing QnnSystemInterface_getProviders: %s", dlerror());
@@ -359,61 +612,619 @@ namespace ar
                     logMsg("QnnSystemInterface_getProviders returned no providers");
                     return false;
                 }
-                p_->sysIface = providers[0];
+                sysIface = providers[0];
             }
 
-            auto &core = p_->iface->QNN_INTERFACE_VER_NAME;
-            auto &sys = p_->sysIface->QNN_SYSTEM_INTERFACE_VER_NAME;
+            auto &core = iface->QNN_INTERFACE_VER_NAME;
 
             // --- log + backend -----------------------------------------------
             QnnLog_Level_t level = (QnnLog_Level_t)(logLevel < QNN_LOG_LEVEL_ERROR ? QNN_LOG_LEVEL_ERROR
                                                     : logLevel > QNN_LOG_LEVEL_DEBUG ? QNN_LOG_LEVEL_DEBUG
                                                                                      : logLevel);
             if (core.logCreate)
-                core.logCreate(qnnLogCallback, level, &p_->logHandle);
+                core.logCreate(qnnLogCallback, level, &logHandle);
 
-            if (core.backendCreate(p_->logHandle, nullptr, &p_->backend) != QNN_SUCCESS)
+            if (core.backendCreate(logHandle, nullptr, &backend) != QNN_SUCCESS)
             {
                 logMsg("backendCreate failed");
                 return false;
             }
 
-            // --- create the context + obtain graph metadata (source-specific) -
-            QnnSystemContext_GraphInfo_t *graphs = nullptr;
+            initialized = true;
+            return true;
+        }
+
+        QnnRuntime::QnnRuntime(std::string backendLibPath, std::string systemLibPath)
+            : p_(new Impl())
+        {
+            p_->backendLibPath = std::move(backendLibPath);
+            p_->systemLibPath = std::move(systemLibPath);
+        }
+
+        QnnRuntime::~QnnRuntime() = default;
+
+        bool QnnRuntime::init(int logLevel)
+        {
+            std::lock_guard<std::mutex> lock(p_->initMutex);
+            if (p_->initialized)
+                return true;
+            if (p_->init(logLevel))
+                return true;
+            p_->release();
+            return false;
+        }
+
+        const std::string &QnnRuntime::backendLibPath() const
+        {
+            return p_->backendLibPath;
+        }
+
+        // =====================================================================
+        // Impl
+        // =====================================================================
+
+        struct QnnModel::Impl
+        {
+            std::string modelPath;
+
+            // libraries, log and backend, possibly shared with other models; the
+            // pointers below are borrowed from it
+            std::shared_ptr<QnnRuntime> runtime;
+            const QnnInterface_t *iface = nullptr;
+            const QnnSystemInterface_t *sysIface = nullptr;
+            Qnn_BackendHandle_t backend = nullptr;
+
+            Qnn_ContextHandle_t context = nullptr;
+
+            // .dlc source
+            QnnSystemDlc_Handle_t dlc = nullptr;
+            QnnSystemContext_GraphInfo_t *dlcGraphs = nullptr; // owned by us; free() at teardown
+
+            // .dlc source, when loaded from memory: mapped as long as the handle lives
+            MappedFile dlcFile;
+
+            // .bin source
+            QnnSystemContext_Handle_t sysCtx = nullptr; // owns the BinaryInfo (+ its tensors/dims)
+
             uint32_t numGraphs = 0;
-            bool needFinalize = false;
 
-            if (!isBinary)
+            std::vector<Qnn_GraphHandle_t> graphHandles;
+            std::vector<std::vector<TensorInfo>> inInfos;
+            std::vector<std::vector<TensorInfo>> outInfos;
+            std::vector<std::vector<Qnn_Tensor_t>> inTensors;
+            std::vector<std::vector<Qnn_Tensor_t>> outTensors;
+            // native-type buffers of the non-float32 tensors (empty for float32,
+            // which stay zero-copy on the caller's buffers)
+            std::vector<std::vector<std::vector<uint8_t>>> inNative;
+            std::vector<std::vector<std::vector<uint8_t>>> outNative;
+
+            // execute() latency ring per graph (see latencyStats)
+            std::vector<std::unique_ptr<LatencyLog>> latency;
+            bool recordLatency = true;
+
+            // ----- asynchronous execution (see submit) --------------------------
+            // one in-flight execution, with its own client tensors/native buffers
+            struct AsyncSlot
             {
-                // .dlc: create an empty context, then compose the DLC's graphs into it
-                if (core.contextCreate(p_->backend, nullptr, nullptr, &p_->context) != QNN_SUCCESS)
-                {
-                    logMsg("contextCreate failed");
-                    return false;
-                }
-                if (sys.systemDlcCreateFromFile(nullptr, p_->modelPath.c_str(), &p_->dlc) != QNN_SUCCESS)
-                {
-                    logMsg("systemDlcCreateFromFile('%s') failed", p_->modelPath.c_str());
-                    return false;
-                }
-                if (sys.systemDlcComposeGraphs(p_->dlc, nullptr, 0,
-                                               p_->backend, p_->context, *p_->iface,
-                                               QNN_SYSTEM_CONTEXT_GRAPH_INFO_VERSION_1,
-                                               &p_->dlcGraphs, &numGraphs) != QNN_SUCCESS ||
-                    p_->dlcGraphs == nullptr || numGraphs == 0)
-                {
-                    logMsg("systemDlcComposeGraphs failed");
-                    return false;
-                }
-                graphs = p_->dlcGraphs;
+                Impl *owner = nullptr;
+                uint32_t graphIdx = 0;
+                std::vector<Qnn_Tensor_t> in, out;
+                std::vector<std::vector<uint8_t>> inNative, outNative;
+                std::vector<float *> outBuffers;
+                std::chrono::steady_clock::time_point submitted, completed;
+                bool done = false; // guarded by asyncMutex
+                Qnn_ErrorHandle_t err = QNN_SUCCESS;
+            };
+            // two slots per graph, used as a FIFO: head is the oldest submission
+            struct AsyncGraph
+            {
+                AsyncSlot slots[2];
+                int head = 0;
+                int inFlight = 0;
+            };
+            std::vector<AsyncGraph> async;
+            mutable std::mutex asyncMutex;
+            std::condition_variable doneCv;
+            bool asyncApiChecked = false; // first graphExecuteAsync decides
+            bool useAsyncApi = true;
+
+            // executor thread, when the backend has no graphExecuteAsync
+            std::thread executor;
+            std::deque<AsyncSlot *> queue; // guarded by asyncMutex
+            std::condition_variable queueCv;
+            bool stopExecutor = false;
+
+            // ----- multi-graph pipeline (see startPipeline) ---------------------
+            // connect()ed tensor pairs, before startPipeline()
+            struct PipeLink
+            {
+                uint32_t srcGraph, srcOutput, dstGraph, dstInput;
+            };
+            std::vector<PipeLink> pipeLinks;
+            // per graph: its own client tensors and rings of native buffers,
+            // indexed by the period a buffer holds data of (modulo ring size).
+            // A connected input has no ring: it reads its source output's.
+            struct PipeGraph
+            {
+                uint32_t delay = 0; // periods behind the pipeline input
+                std::vector<Qnn_Tensor_t> in, out;
+                std::vector<int> srcGraph, srcOutput; // per input, -1 if external
+                std::vector<std::vector<std::vector<uint8_t>>> inRing, outRing;
+                std::vector<uint8_t> outExternal; // per output: not connected anywhere
+                bool callerRuns = false; // else on its worker thread
+                uint64_t go = 0, ran = 0; // guarded by pipeMutex
+                Qnn_ErrorHandle_t err = QNN_SUCCESS;
+            };
+            std::vector<PipeGraph> pipe;
+            std::vector<std::vector<uint32_t>> pipeWaves; // graphs run together, in order
+            std::vector<TensorInfo> pipeInInfos, pipeOutInfos;
+            uint32_t pipeDepth = 0;
+            uint64_t pipePeriod = 0; // starts at pipeDepth, so period - delay >= 0
+            bool pipeRunning = false;
+            std::vector<std::thread> pipeWorkers;
+            std::mutex pipeMutex;
+            std::condition_variable pipeGoCv, pipeDoneCv;
+            int pipePending = 0; // guarded by pipeMutex
+            bool stopPipe = false;
+            int pipePriority = -1;     // see setPipelineScheduling
+            std::vector<int> pipeCpus;
+
+            // profiling (see setProfiling): per graph, op name -> aggregate
+            ProfilingLevel profilingLevel = ProfilingLevel::Off;
+            Qnn_ProfileHandle_t profile = nullptr;
+            std::vector<std::map<std::string, OpProfile>> opStats;
+            void collectProfile(uint32_t g);
+            void addProfileEvent(uint32_t g, const char *name, const QnnProfile_EventData_t &data);
+
+            // context binary cache (see setContextCache)
+            bool useContextCache = true;
+            bool loadedFromCache = false;
+
+            bool loaded = false;
+
+            ~Impl() { teardown(); }
+            void teardown();
+
+            void bindIO(uint32_t g,
+                        std::vector<Qnn_Tensor_t> &inT, std::vector<Qnn_Tensor_t> &outT,
+                        std::vector<std::vector<uint8_t>> &inN,
+                        const std::vector<std::vector<uint8_t>> &outN,
+                        const float *const *inputBuffers, float *const *outputBuffers);
+            void readOutputs(uint32_t g, const std::vector<std::vector<uint8_t>> &outN,
+                             float *const *outputBuffers);
+            void logLatency(uint32_t g, float us);
+            void complete(AsyncSlot *slot, Qnn_ErrorHandle_t err);
+            static void onAsyncDone(void *param, Qnn_NotifyStatus_t status);
+            void executorLoop();
+
+            static size_t ringSlot(uint64_t period, size_t ringSize) { return (size_t)(period % ringSize); }
+            void runPipeGraph(uint32_t g);
+            void pipeWorkerLoop(uint32_t g);
+            void stopPipeline();
+        };
+
+        // point float32 tensors at the caller's buffers, convert the other inputs
+        void QnnModel::Impl::bindIO(uint32_t g,
+                                    std::vector<Qnn_Tensor_t> &inT, std::vector<Qnn_Tensor_t> &outT,
+                                    std::vector<std::vector<uint8_t>> &inN,
+                                    const std::vector<std::vector<uint8_t>> &outN,
+                                    const float *const *inputBuffers, float *const *outputBuffers)
+        {
+            auto &inI = inInfos[g];
+            auto &outI = outInfos[g];
+
+            // fp32 zero-copy: point the client buffers straight at the caller's
+            // float arrays (QNN only reads inputs, so the const_cast is safe).
+            // Other types are converted into their native buffers.
+            for (size_t i = 0; i < inT.size(); ++i)
+            {
+                if (inN[i].empty())
+                    tensorSetRawBuffer(inT[i], const_cast<float *>(inputBuffers[i]),
+                                       (uint32_t)(inI[i].numElements * sizeof(float)));
+                else
+                    toNative(inI[i], inputBuffers[i], inN[i].data());
+            }
+            for (size_t i = 0; i < outT.size(); ++i)
+            {
+                if (outN[i].empty())
+                    tensorSetRawBuffer(outT[i], outputBuffers[i],
+                                       (uint32_t)(outI[i].numElements * sizeof(float)));
+            }
+        }
+
+        void QnnModel::Impl::readOutputs(uint32_t g, const std::vector<std::vector<uint8_t>> &outN,
+                                         float *const *outputBuffers)
+        {
+            for (size_t i = 0; i < outN.size(); ++i)
+            {
+                if (!outN[i].empty())
+                    fromNative(outInfos[g][i], outN[i].data(), outputBuffers[i]);
+            }
+        }
+
+        void QnnModel::Impl::logLatency(uint32_t g, float us)
+        {
+            if (!recordLatency)
+                return;
+            latency[g]->record(us);
+        }
+
+        void QnnModel::Impl::addProfileEvent(uint32_t g, const char *name, const QnnProfile_EventData_t &data)
+        {
+            const char *unit;
+            switch (data.unit)
+            {
+            case QNN_PROFILE_EVENTUNIT_MICROSEC: unit = "us";     break;
+            case QNN_PROFILE_EVENTUNIT_CYCLES:   unit = "cycles"; break;
+            default:                             return; // counts, bytes: not timings
+            }
+            OpProfile &op = opStats[g][name];
+            if (op.count == 0)
+            {
+                op.name = name;
+                op.unit = unit;
+            }
+            ++op.count;
+            op.total += (double)data.value;
+            op.max = std::max(op.max, (double)data.value);
+        }
+
+        // events of the last execute(): the execute event, with the nodes below it
+        void QnnModel::Impl::collectProfile(uint32_t g)
+        {
+            auto &core = iface->QNN_INTERFACE_VER_NAME;
+            const QnnProfile_EventId_t *events = nullptr;
+            uint32_t numEvents = 0;
+            if (core.profileGetEvents(profile, &events, &numEvents) != QNN_SUCCESS)
+                return;
+            for (uint32_t e = 0; e < numEvents; ++e)
+            {
+                QnnProfile_EventData_t data;
+                if (core.profileGetEventData(events[e], &data) != QNN_SUCCESS ||
+                    data.type != QNN_PROFILE_EVENTTYPE_EXECUTE)
+                    continue;
+                addProfileEvent(g, "<execute>", data);
+
+                const QnnProfile_EventId_t *subEvents = nullptr;
+                uint32_t numSubEvents = 0;
+                if (core.profileGetSubEvents(events[e], &subEvents, &numSubEvents) != QNN_SUCCESS)
+                    continue;
+                for (uint32_t k = 0; k < numSubEvents; ++k)
+                {
+                    QnnProfile_EventData_t sub;
+                    if (core.profileGetEventData(subEvents[k], &sub) == QNN_SUCCESS &&
+                        sub.type == QNN_PROFILE_EVENTTYPE_NODE)
+                        addProfileEvent(g, sub.identifier ? sub.identifier : "?", sub);
+                }
+            }
+        }
+
+        void QnnModel::Impl::complete(AsyncSlot *slot, Qnn_ErrorHandle_t err)
+        {
+            {
+                std::lock_guard<std::mutex> lock(asyncMutex);
+                slot->err = err;
+                slot->completed = std::chrono::steady_clock::now();
+                slot->done = true;
+            }
+            doneCv.notify_all();
+        }
+
+        // graphExecuteAsync completion, on a backend thread
+        void QnnModel::Impl::onAsyncDone(void *param, Qnn_NotifyStatus_t status)
+        {
+            AsyncSlot *slot = (AsyncSlot *)param;
+            slot->owner->complete(slot, status.error);
+        }
+
+        void QnnModel::Impl::executorLoop()
+        {
+            auto &core = iface->QNN_INTERFACE_VER_NAME;
+            for (;;)
+            {
+                AsyncSlot *slot;
+                {
+                    std::unique_lock<std::mutex> lock(asyncMutex);
+                    queueCv.wait(lock, [this] { return stopExecutor || !queue.empty(); });
+                    if (queue.empty())
+                        return; // stopping, nothing left to run
+                    slot = queue.front();
+                    queue.pop_front();
+                }
+                Qnn_ErrorHandle_t err = core.graphExecute(graphHandles[slot->graphIdx],
+                                                          slot->in.data(), (uint32_t)slot->in.size(),
+                                                          slot->out.data(), (uint32_t)slot->out.size(),
+                                                          nullptr, nullptr);
+                complete(slot, err);
+            }
+        }
+
+        // run graph g for the current pipeline period: point its tensors at the
+        // ring slots of the period it is behind by, then execute
+        void QnnModel::Impl::runPipeGraph(uint32_t g)
+        {
+            auto &core = iface->QNN_INTERFACE_VER_NAME;
+            PipeGraph &pg = pipe[g];
+            const uint64_t period = pipePeriod - pg.delay;
+            for (size_t i = 0; i < pg.in.size(); ++i)
+            {
+                auto &ring = pg.srcGraph[i] < 0 ? pg.inRing[i] : pipe[pg.srcGraph[i]].outRing[pg.srcOutput[i]];
+                auto &buf = ring[ringSlot(period, ring.size())];
+                tensorSetRawBuffer(pg.in[i], buf.data(), (uint32_t)buf.size());
+            }
+            for (size_t i = 0; i < pg.out.size(); ++i)
+            {
+                auto &buf = pg.outRing[i][ringSlot(period, pg.outRing[i].size())];
+                tensorSetRawBuffer(pg.out[i], buf.data(), (uint32_t)buf.size());
+            }
+
+            auto t0 = std::chrono::steady_clock::now();
+            pg.err = core.graphExecute(graphHandles[g], pg.in.data(), (uint32_t)pg.in.size(),
+                                       pg.out.data(), (uint32_t)pg.out.size(), nullptr, nullptr);
+            logLatency(g, std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - t0).count());
+        }
+
+        void QnnModel::Impl::pipeWorkerLoop(uint32_t g)
+        {
+            PipeGraph &pg = pipe[g];
+            for (;;)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(pipeMutex);
+                    pipeGoCv.wait(lock, [this, &pg] { return stopPipe || pg.go != pg.ran; });
+                    if (stopPipe)
+                        return;
+                }
+                runPipeGraph(g);
+                {
+                    std::lock_guard<std::mutex> lock(pipeMutex);
+                    ++pg.ran;
+                    --pipePending;
+                }
+                pipeDoneCv.notify_all();
+            }
+        }
+
+        void QnnModel::Impl::stopPipeline()
+        {
+            {
+                std::lock_guard<std::mutex> lock(pipeMutex);
+                stopPipe = true;
+            }
+            pipeGoCv.notify_all();
+            for (auto &t : pipeWorkers)
+                t.join();
+            pipeWorkers.clear();
+            stopPipe = false;
+            pipePending = 0;
+            pipe.clear();
+            pipeWaves.clear();
+            pipeInInfos.clear();
+            pipeOutInfos.clear();
+            pipeDepth = 0;
+            pipePeriod = 0;
+            pipeRunning = false;
+        }
+
+        void QnnModel::Impl::teardown()
+        {
+            stopPipeline();
+            pipeLinks.clear();
+
+            // nothing may still be running on the graphs we are about to free
+            {
+                std::unique_lock<std::mutex> lock(asyncMutex);
+                for (auto &ag : async)
+                    for (int k = 0; k < ag.inFlight; ++k)
+                    {
+                        AsyncSlot &slot = ag.slots[(ag.head + k) % 2];
+                        doneCv.wait(lock, [&slot] { return slot.done; });
+                    }
+                stopExecutor = true;
+            }
+            queueCv.notify_all();
+            if (executor.joinable())
+                executor.join();
+            stopExecutor = false;
+            async.clear();
+            asyncApiChecked = false;
+            useAsyncApi = true;
+
+            if (iface)
+            {
+                auto &core = iface->QNN_INTERFACE_VER_NAME;
+                if (profile && core.profileFree)
+                    core.profileFree(profile);
+                if (context && core.contextFree)
+                    core.contextFree(context, nullptr);
+            }
+            profile = nullptr;
+            opStats.clear();
+            context = nullptr;
+            backend = nullptr;
+
+            if (sysIface)
+            {
+                auto &sys = sysIface->QNN_SYSTEM_INTERFACE_VER_NAME;
+                if (dlc && sys.systemDlcFree)
+                    sys.systemDlcFree(dlc);
+                if (sysCtx && sys.systemContextFree)
+                    sys.systemContextFree(sysCtx); // frees the BinaryInfo it owns
+            }
+            dlc = nullptr;
+            sysCtx = nullptr;
+
+            if (dlcGraphs)
+            {
+                free(dlcGraphs); // composeGraphs: "Memory allocated in graphs is owned by clients"
+                dlcGraphs = nullptr;
+            }
+            numGraphs = 0;
+
+            graphHandles.clear();
+            inInfos.clear();
+            outInfos.clear();
+            inTensors.clear();
+            outTensors.clear();
+            inNative.clear();
+            outNative.clear();
+            dlcFile.unmap(); // after systemDlcFree
+            latency.clear();
+
+            // the runtime is not ours to release; it goes with the last model holding it
+            iface = nullptr;
+            sysIface = nullptr;
+            loaded = false;
+        }
+
+        // =====================================================================
+        // QnnModel
+        // =====================================================================
+
+        QnnModel::QnnModel(std::string backendLibPath, std::string modelPath, std::string systemLibPath)
+            : p_(new Impl())
+        {
+            p_->runtime = std::make_shared<QnnRuntime>(std::move(backendLibPath), std::move(systemLibPath));
+            p_->modelPath = std::move(modelPath);
+        }
+
+        QnnModel::QnnModel(std::shared_ptr<QnnRuntime> runtime, std::string modelPath)
+            : p_(new Impl())
+        {
+            p_->runtime = std::move(runtime);
+            p_->modelPath = std::move(modelPath);
+        }
+
+        QnnModel::~QnnModel() = default;
+
+        void QnnModel::setContextCache(bool enable)
+        {
+            p_->useContextCache = enable;
+        }
+
+        bool QnnModel::load(int logLevel)
+        {
+            if (p_->loaded)
+                return true;
+            if (loadModel(logLevel))
+                return true;
+            if (!p_->loadedFromCache)
+                return false;
+
+            // drop the stamp so the retry composes the DLC and rebuilds the cache
+            std::string cachePath = contextCachePath(p_->modelPath, p_->runtime->backendLibPath());
+            logMsg("cached context '%s' unusable, composing the DLC again", cachePath.c_str());
+            remove((cachePath + ".stamp").c_str());
+            p_->teardown();
+            return loadModel(logLevel);
+        }
+
+        bool QnnModel::loadModel(int logLevel)
+        {
+            // choose the source format from the file extension
+            bool isBinary;
+            if (endsWith(p_->modelPath, ".bin"))
+                isBinary = true;
+            else if (endsWith(p_->modelPath, ".dlc"))
+                isBinary = false;
+            else
+            {
+                logMsg("unknown model format for '%s' (expected .dlc or .bin)", p_->modelPath.c_str());
+                return false;
+            }
+
+            // a .dlc with an up-to-date cached context loads as that context binary
+            std::string binaryPath = p_->modelPath;
+            std::string cachePath, stamp;
+            p_->loadedFromCache = false;
+            if (!isBinary && p_->useContextCache)
+            {
+                cachePath = contextCachePath(p_->modelPath, p_->runtime->backendLibPath());
+                std::string settings = contextCacheSettings(p_->runtime->backendLibPath());
+                ar::cache::Lookup cache;
+                if (!settings.empty())
+                    cache = ar::cache::lookup(cachePath + ".stamp", settings, p_->modelPath);
+                stamp = cache.stamp;
+                if (cache.upToDate)
+                {
+                    isBinary = true;
+                    binaryPath = cachePath;
+                    p_->loadedFromCache = true;
+                }
+            }
+
+            // --- libraries, log and backend: the (possibly shared) runtime ----
+            if (!p_->runtime->init(logLevel))
+                return false;
+            QnnRuntime::Impl &rt = *p_->runtime->p_;
+            p_->iface = rt.iface;
+            p_->sysIface = rt.sysIface;
+            p_->backend = rt.backend;
+
+            auto &core = p_->iface->QNN_INTERFACE_VER_NAME;
+            auto &sys = p_->sysIface->QNN_SYSTEM_INTERFACE_VER_NAME;
+
+            if (p_->profilingLevel != ProfilingLevel::Off)
+            {
+                QnnProfile_Level_t profLevel = p_->profilingLevel == ProfilingLevel::Detailed ? QNN_PROFILE_LEVEL_DETAILED
+                                                                                                : QNN_PROFILE_LEVEL_BASIC;
+                if (!core.profileCreate || core.profileCreate(p_->backend, profLevel, &p_->profile) != QNN_SUCCESS)
+                {
+                    logMsg("warning: profileCreate failed, profiling disabled");
+                    p_->profile = nullptr;
+                }
+            }
+
+            // --- create the context + obtain graph metadata (source-specific) -
+            QnnSystemContext_GraphInfo_t *graphs = nullptr;
+            uint32_t numGraphs = 0;
+            bool needFinalize = false;
+
+            if (!isBinary)
+            {
+                // .dlc: create an empty context, then compose the DLC's graphs into it
+                if (core.contextCreate(p_->backend, nullptr, nullptr, &p_->context) != QNN_SUCCESS)
+                {
+                    logMsg("contextCreate failed");
+                    return false;
+                }
+                // from a mapping of the file when the system library can, so the DLC
+                // stays in (reclaimable) page cache rather than in a heap copy
+                if (sys.systemDlcCreateFromBinary && p_->dlcFile.map(p_->modelPath))
+                {
+                    if (sys.systemDlcCreateFromBinary(nullptr, p_->dlcFile.data,
+                                                      (Qnn_ContextBinarySize_t)p_->dlcFile.size,
+                                                      &p_->dlc) != QNN_SUCCESS)
+                    {
+                        logMsg("systemDlcCreateFromBinary('%s') failed", p_->modelPath.c_str());
+                        return false;
+                    }
+                }
+                else if (sys.systemDlcCreateFromFile(nullptr, p_->modelPath.c_str(), &p_->dlc) != QNN_SUCCESS)
+                {
+                    logMsg("systemDlcCreateFromFile('%s') failed", p_->modelPath.c_str());
+                    return false;
+                }
+                if (sys.systemDlcComposeGraphs(p_->dlc, nullptr, 0,
+                                               p_->backend, p_->context, *p_->iface,
+                                               QNN_SYSTEM_CONTEXT_GRAPH_INFO_VERSION_1,
+                                               &p_->dlcGraphs, &numGraphs) != QNN_SUCCESS ||
+                    p_->dlcGraphs == nullptr || numGraphs == 0)
+                {
+                    logMsg("systemDlcComposeGraphs failed");
+                    return false;
+                }
+                graphs = p_->dlcGraphs;
                 needFinalize = true; // composed graphs must be finalized before execute
             }
             else
             {
-                // .bin: read graph metadata from the binary, then create the context from it
-                if (!readFile(p_->modelPath, p_->binaryBuffer))
+                // .bin: read graph metadata from the binary, then create the context from
+                // it. The mapping is only needed until the backend has consumed it
+                MappedFile binary;
+                if (!binary.map(binaryPath))
                 {
-                    logMsg("failed to read context binary '%s'", p_->modelPath.c_str());
+                    logMsg("failed to map context binary '%s'", binaryPath.c_str());
                     return false;
                 }
                 if (sys.systemContextCreate(&p_->sysCtx) != QNN_SUCCESS)
@@ -424,8 +1235,8 @@ namespace ar
                 const QnnSystemContext_BinaryInfo_t *binInfo = nullptr;
                 Qnn_ContextBinarySize_t binInfoSize = 0;
                 if (sys.systemContextGetBinaryInfo(p_->sysCtx,
-                                                   p_->binaryBuffer.data(),
-                                                   (uint64_t)p_->binaryBuffer.size(),
+                                                   binary.data,
+                                                   (uint64_t)binary.size,
                                                    &binInfo, &binInfoSize) != QNN_SUCCESS ||
                     binInfo == nullptr)
                 {
@@ -439,13 +1250,14 @@ namespace ar
                     return false;
                 }
                 if (core.contextCreateFromBinary(p_->backend, nullptr, nullptr,
-                                                 p_->binaryBuffer.data(),
-                                                 (Qnn_ContextBinarySize_t)p_->binaryBuffer.size(),
+                                                 binary.data,
+                                                 (Qnn_ContextBinarySize_t)binary.size,
                                                  &p_->context, nullptr) != QNN_SUCCESS)
                 {
                     logMsg("contextCreateFromBinary failed");
                     return false;
                 }
+                binary.unmap();
                 needFinalize = false; // a context binary is already finalized
             }
 
@@ -456,6 +1268,13 @@ namespace ar
             p_->outInfos.resize(numGraphs);
             p_->inTensors.resize(numGraphs);
             p_->outTensors.resize(numGraphs);
+            p_->inNative.resize(numGraphs);
+            p_->outNative.resize(numGraphs);
+            p_->latency.clear();
+            for (uint32_t g = 0; g < numGraphs; ++g)
+                p_->latency.emplace_back(new LatencyLog());
+            p_->async = std::vector<Impl::AsyncGraph>(numGraphs);
+            p_->opStats.assign(numGraphs, std::map<std::string, OpProfile>());
 
             for (uint32_t g = 0; g < numGraphs; ++g)
             {
@@ -478,19 +1297,36 @@ namespace ar
 
                 auto prepare = [&](Qnn_Tensor_t *src, uint32_t n,
                                    std::vector<TensorInfo> &infos,
-                                   std::vector<Qnn_Tensor_t> &clients) -> bool
+                                   std::vector<Qnn_Tensor_t> &clients,
+                                   std::vector<std::vector<uint8_t>> &native) -> bool
                 {
                     infos.resize(n);
                     clients.resize(n);
+                    native.resize(n);
                     for (uint32_t i = 0; i < n; ++i)
                     {
-                        if (tensorDataType(src[i]) != QNN_DATATYPE_FLOAT_32)
+                        if (!elementTypeOf(tensorDataType(src[i]), &infos[i].type))
                         {
-                            logMsg("tensor '%s' has dtype %d; only FLOAT_32 is wired currently "
-                                   "(add a conversion path in QnnModel.cpp)",
+                            logMsg("tensor '%s' has dtype %d; supported: FLOAT_32, FLOAT_16, "
+                                   "U/SFIXED_POINT_8, U/SFIXED_POINT_16",
                                    tensorName(src[i]), (int)tensorDataType(src[i]));
                             return false;
                         }
+                        if (infos[i].type != ElementType::Float32 && infos[i].type != ElementType::Float16)
+                        {
+                            const Qnn_QuantizeParams_t &qp = tensorQuantizeParams(src[i]);
+                            if (qp.encodingDefinition != QNN_DEFINITION_DEFINED ||
+                                qp.quantizationEncoding != QNN_QUANTIZATION_ENCODING_SCALE_OFFSET ||
+                                qp.scaleOffsetEncoding.scale <= 0.f)
+                            {
+                                logMsg("tensor '%s': only per-tensor scale/offset quantization is supported "
+                                       "for graph I/O (encoding %d)",
+                                       tensorName(src[i]), (int)qp.quantizationEncoding);
+                                return false;
+                            }
+                            infos[i].scale = qp.scaleOffsetEncoding.scale;
+                            infos[i].offset = qp.scaleOffsetEncoding.offset;
+                        }
                         const uint32_t rank = tensorRank(src[i]);
                         const uint32_t *dims = tensorDims(src[i]);
                         infos[i].name = tensorName(src[i]);
@@ -500,17 +1336,67 @@ namespace ar
                         // client tensor: shallow copy of the descriptor (shares the
                         // name/dimensions owned by the DLC graphs array or the system
                         // context, both kept alive for our lifetime), switched to a
-                        // RAW client buffer we point at execute time.
+                        // RAW client buffer. float32 ones are pointed at the caller's
+                        // buffers at execute time; the others at their native buffer,
+                        // for good.
                         clients[i] = src[i];
-                        tensorSetRawBuffer(clients[i], nullptr, 0);
+                        if (infos[i].type == ElementType::Float32)
+                            tensorSetRawBuffer(clients[i], nullptr, 0);
+                        else
+                        {
+                            native[i].assign(infos[i].numElements * elementBytes(infos[i].type), 0);
+                            tensorSetRawBuffer(clients[i], native[i].data(), (uint32_t)native[i].size());
+                        }
                     }
                     return true;
                 };
 
-                if (!prepare(ins, nIn, p_->inInfos[g], p_->inTensors[g]))
+                if (!prepare(ins, nIn, p_->inInfos[g], p_->inTensors[g], p_->inNative[g]))
                     return false;
-                if (!prepare(outs, nOut, p_->outInfos[g], p_->outTensors[g]))
+                if (!prepare(outs, nOut, p_->outInfos[g], p_->outTensors[g], p_->outNative[g]))
                     return false;
+
+                // async slots: the same client tensors, with native buffers of their own
+                for (auto &slot : p_->async[g].slots)
+                {
+                    slot.owner = p_.get();
+                    slot.graphIdx = g;
+                    slot.in = p_->inTensors[g];
+                    slot.out = p_->outTensors[g];
+                    slot.inNative = p_->inNative[g];
+                    slot.outNative = p_->outNative[g];
+                    slot.outBuffers.assign(nOut, nullptr);
+                    for (uint32_t i = 0; i < nIn; ++i)
+                        if (!slot.inNative[i].empty())
+                            tensorSetRawBuffer(slot.in[i], slot.inNative[i].data(), (uint32_t)slot.inNative[i].size());
+                    for (uint32_t i = 0; i < nOut; ++i)
+                        if (!slot.outNative[i].empty())
+                            tensorSetRawBuffer(slot.out[i], slot.outNative[i].data(), (uint32_t)slot.outNative[i].size());
+                }
+            }
+
+            // --- freshly composed: serialize the finalized context for next time
+            if (needFinalize && !stamp.empty())
+            {
+                Qnn_ContextBinarySize_t size = 0, written = 0;
+                std::vector<uint8_t> binary;
+                bool saved = false;
+                if (core.contextGetBinarySize && core.contextGetBinary &&
+                    core.contextGetBinarySize(p_->context, &size) == QNN_SUCCESS && size > 0)
+                {
+                    binary.resize((size_t)size);
+                    std::string tmpPath = cachePath + ".tmp";
+                    saved = core.contextGetBinary(p_->context, binary.data(), size, &written) == QNN_SUCCESS &&
+                            writeFile(tmpPath, binary.data(), (size_t)written) &&
+                            ar::cache::publish(tmpPath, cachePath, cachePath + ".stamp", stamp);
+                    if (!saved)
+                        remove(tmpPath.c_str());
+                }
+                if (saved)
+                    logMsg("saved context binary '%s'", cachePath.c_str());
+                else
+                    logMsg("warning: unable to save context binary '%s', the DLC will be composed again on next load",
+                           cachePath.c_str());
             }
 
             p_->loaded = true;
@@ -542,29 +1428,689 @@ namespace ar
             auto &core = p_->iface->QNN_INTERFACE_VER_NAME;
             auto &inT = p_->inTensors[graphIdx];
             auto &outT = p_->outTensors[graphIdx];
-            auto &inI = p_->inInfos[graphIdx];
-            auto &outI = p_->outInfos[graphIdx];
-
-            // fp32 zero-copy: point the client buffers straight at the caller's
-            // float arrays (QNN only reads inputs, so the const_cast is safe).
-            for (size_t i = 0; i < inT.size(); ++i)
-                tensorSetRawBuffer(inT[i], const_cast<float *>(inputBuffers[i]),
-                                   (uint32_t)(inI[i].numElements * sizeof(float)));
-            for (size_t i = 0; i < outT.size(); ++i)
-                tensorSetRawBuffer(outT[i], outputBuffers[i],
-                                   (uint32_t)(outI[i].numElements * sizeof(float)));
+            p_->bindIO(graphIdx, inT, outT, p_->inNative[graphIdx], p_->outNative[graphIdx],
+                       inputBuffers, outputBuffers);
 
+            auto t0 = std::chrono::steady_clock::now();
             Qnn_ErrorHandle_t err = core.graphExecute(p_->graphHandles[graphIdx],
                                                       inT.data(), (uint32_t)inT.size(),
                                                       outT.data(), (uint32_t)outT.size(),
-                                                      nullptr, nullptr);
+                                                      p_->profile, nullptr);
             if (err != QNN_SUCCESS)
             {
                 logMsg("graphExecute failed (err=%lld)", (long long)err);
                 return false;
             }
+            if (p_->profile)
+                p_->collectProfile(graphIdx);
+            p_->readOutputs(graphIdx, p_->outNative[graphIdx], outputBuffers);
+            p_->logLatency(graphIdx, std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - t0).count());
             return true;
         }
 
+        bool QnnModel::submit(uint32_t graphIdx,
+                              const float *const *inputBuffers,
+                              float *const *outputBuffers)
+        {
+            if (!p_->loaded || graphIdx >= p_->numGraphs)
+                return false;
+
+            Impl::AsyncGraph &ag = p_->async[graphIdx];
+            if (ag.inFlight == 2)
+            {
+                logMsg("submit: graph %u already has two submissions in flight, wait() first", graphIdx);
+                return false;
+            }
+            Impl::AsyncSlot &slot = ag.slots[(ag.head + ag.inFlight) % 2];
+            p_->bindIO(graphIdx, slot.in, slot.out, slot.inNative, slot.outNative, inputBuffers, outputBuffers);
+            slot.outBuffers.assign(outputBuffers, outputBuffers + slot.out.size());
+            {
+                std::lock_guard<std::mutex> lock(p_->asyncMutex);
+                slot.done = false;
+                slot.err = QNN_SUCCESS;
+            }
+            slot.submitted = std::chrono::steady_clock::now();
+
+            auto &core = p_->iface->QNN_INTERFACE_VER_NAME;
+            if (p_->useAsyncApi && core.graphExecuteAsync)
+            {
+                Qnn_ErrorHandle_t err = core.graphExecuteAsync(p_->graphHandles[graphIdx],
+                                                               slot.in.data(), (uint32_t)slot.in.size(),
+                                                               slot.out.data(), (uint32_t)slot.out.size(),
+                                                               nullptr, nullptr, &Impl::onAsyncDone, &slot);
+                if (err == QNN_SUCCESS)
+                {
+                    p_->asyncApiChecked = true;
+                    ++ag.inFlight;
+                    return true;
+                }
+                if (p_->asyncApiChecked)
+                {
+                    logMsg("graphExecuteAsync failed (err=%lld)", (long long)err);
+                    return false;
+                }
+                logMsg("graphExecuteAsync not available (err=%lld), using an executor thread", (long long)err);
+            }
+
+            // no async support in the backend: run it on our own thread
+            p_->useAsyncApi = false;
+            p_->asyncApiChecked = true;
+            if (!p_->executor.joinable())
+                p_->executor = std::thread(&Impl::executorLoop, p_.get());
+            {
+                std::lock_guard<std::mutex> lock(p_->asyncMutex);
+                p_->queue.push_back(&slot);
+            }
+            p_->queueCv.notify_one();
+            ++ag.inFlight;
+            return true;
+        }
+
+        bool QnnModel::poll(uint32_t graphIdx) const
+        {
+            if (!p_->loaded || graphIdx >= p_->numGraphs)
+                return false;
+            const Impl::AsyncGraph &ag = p_->async[graphIdx];
+            std::lock_guard<std::mutex> lock(p_->asyncMutex);
+            return ag.inFlight > 0 && ag.slots[ag.head].done;
+        }
+
+        bool QnnModel::wait(uint32_t graphIdx)
+        {
+            if (!p_->loaded || graphIdx >= p_->numGraphs)
+                return false;
+            Impl::AsyncGraph &ag = p_->async[graphIdx];
+            if (ag.inFlight == 0)
+                return false;
+
+            Impl::AsyncSlot &slot = ag.slots[ag.head];
+            {
+                std::unique_lock<std::mutex> lock(p_->asyncMutex);
+                p_->doneCv.wait(lock, [&slot] { return slot.done; });
+            }
+            ag.head = (ag.head + 1) % 2;
+            --ag.inFlight;
+
+            if (slot.err != QNN_SUCCESS)
+            {
+                logMsg("asynchronous graph execution failed (err=%lld)", (long long)slot.err);
+                return false;
+            }
+            p_->readOutputs(graphIdx, slot.outNative, slot.outBuffers.data());
+            p_->logLatency(graphIdx, std::chrono::duration<float, std::micro>(slot.completed - slot.submitted).count());
+            return true;
+        }
+
+        bool QnnModel::connect(uint32_t srcGraph, uint32_t srcOutput, uint32_t dstGraph, uint32_t dstInput)
+        {
+            if (!p_->loaded || p_->pipeRunning)
+                return false;
+            if (srcGraph >= p_->numGraphs || dstGraph >= p_->numGraphs ||
+                srcOutput >= p_->outInfos[srcGraph].size() || dstInput >= p_->inInfos[dstGraph].size())
+            {
+                logMsg("connect: no such graph output/input");
+                return false;
+            }
+            if (srcGraph == dstGraph)
+            {
+                logMsg("connect: graph %u feeds itself", srcGraph);
+                return false;
+            }
+            const TensorInfo &src = p_->outInfos[srcGraph][srcOutput];
+            const TensorInfo &dst = p_->inInfos[dstGraph][dstInput];
+            // shared as-is, so the bytes must mean the same on both sides
+            if (src.type != dst.type || src.numElements != dst.numElements ||
+                src.scale != dst.scale || src.offset != dst.offset)
+            {
+                logMsg("connect: '%s' -> '%s': size, type or quantization differ",
+                       src.name.c_str(), dst.name.c_str());
+                return false;
+            }
+            for (const auto &l : p_->pipeLinks)
+                if (l.dstGraph == dstGraph && l.dstInput == dstInput)
+                {
+                    logMsg("connect: input '%s' is already connected", dst.name.c_str());
+                    return false;
+                }
+            p_->pipeLinks.push_back({srcGraph, srcOutput, dstGraph, dstInput});
+            return true;
+        }
+
+        void QnnModel::setPipelineScheduling(int priority, const std::vector<int> &cpus)
+        {
+            p_->pipePriority = priority;
+            p_->pipeCpus = cpus;
+        }
+
+        bool QnnModel::startPipeline(bool pipelined)
+        {
+            if (!p_->loaded || p_->pipeRunning || p_->numGraphs == 0)
+                return false;
+            const uint32_t numGraphs = p_->numGraphs;
+            auto &pipe = p_->pipe;
+            pipe = std::vector<Impl::PipeGraph>(numGraphs);
+            for (uint32_t g = 0; g < numGraphs; ++g)
+            {
+                pipe[g].srcGraph.assign(p_->inInfos[g].size(), -1);
+                pipe[g].srcOutput.assign(p_->inInfos[g].size(), -1);
+                pipe[g].outExternal.assign(p_->outInfos[g].size(), 1);
+            }
+            for (const auto &l : p_->pipeLinks)
+            {
+                pipe[l.dstGraph].srcGraph[l.dstInput] = (int)l.srcGraph;
+                pipe[l.dstGraph].srcOutput[l.dstInput] = (int)l.srcOutput;
+                pipe[l.srcGraph].outExternal[l.srcOutput] = 0;
+            }
+
+            // stage of a graph: the longest chain of graphs feeding it
+            std::vector<uint32_t> stage(numGraphs, 0);
+            bool changed = true;
+            for (uint32_t pass = 0; changed; ++pass)
+            {
+                if (pass > numGraphs)
+                {
+                    logMsg("startPipeline: the connections form a cycle");
+                    pipe.clear();
+                    return false;
+                }
+                changed = false;
+                for (const auto &l : p_->pipeLinks)
+                    if (stage[l.dstGraph] < stage[l.srcGraph] + 1)
+                    {
+                        stage[l.dstGraph] = stage[l.srcGraph] + 1;
+                        changed = true;
+                    }
+            }
+            uint32_t numStages = 0;
+            for (uint32_t g = 0; g < numGraphs; ++g)
+                numStages = std::max(numStages, stage[g] + 1);
+
+            // Pipelined: stage s works s periods behind the input, so every graph
+            // of a period reads what the previous one left and all run at once.
+            // Otherwise the stages run one after the other within the period.
+            p_->pipeDepth = pipelined ? numStages - 1 : 0;
+            if (pipelined)
+                p_->pipeWaves.assign(1, {});
+            else
+                p_->pipeWaves.assign(numStages, {});
+            for (uint32_t g = 0; g < numGraphs; ++g)
+            {
+                pipe[g].delay = pipelined ? stage[g] : 0;
+                p_->pipeWaves[pipelined ? 0 : stage[g]].push_back(g);
+            }
+
+            // rings: an output is kept until its slowest reader (or, external, the
+            // pipeline output) has consumed it; an external input until its graph has
+            uint32_t depth = p_->pipeDepth;
+            std::vector<std::vector<uint32_t>> outRingSize(numGraphs);
+            for (uint32_t g = 0; g < numGraphs; ++g)
+            {
+                outRingSize[g].assign(p_->outInfos[g].size(), 1);
+                for (size_t i = 0; i < outRingSize[g].size(); ++i)
+                    if (pipe[g].outExternal[i])
+                        outRingSize[g][i] = depth - pipe[g].delay + 1;
+            }
+            for (const auto &l : p_->pipeLinks)
+            {
+                uint32_t &size = outRingSize[l.srcGraph][l.srcOutput];
+                size = std::max(size, pipe[l.dstGraph].delay - pipe[l.srcGraph].delay + 1);
+            }
+            p_->pipeInInfos.clear();
+            p_->pipeOutInfos.clear();
+            for (uint32_t g = 0; g < numGraphs; ++g)
+            {
+                Impl::PipeGraph &pg = pipe[g];
+                pg.in = p_->inTensors[g];
+                pg.out = p_->outTensors[g];
+                pg.inRing.resize(pg.in.size());
+                pg.outRing.resize(pg.out.size());
+                for (size_t i = 0; i < pg.in.size(); ++i)
+                {
+                    if (pg.srcGraph[i] >= 0)
+                        continue;
+                    const TensorInfo &info = p_->inInfos[g][i];
+                    pg.inRing[i].assign(pg.delay + 1, std::vector<uint8_t>(info.numElements * elementBytes(info.type), 0));
+                    p_->pipeInInfos.push_back(info);
+                }
+                for (size_t i = 0; i < pg.out.size(); ++i)
+                {
+                    const TensorInfo &info = p_->outInfos[g][i];
+                    pg.outRing[i].assign(outRingSize[g][i], std::vector<uint8_t>(info.numElements * elementBytes(info.type), 0));
+                    if (pg.outExternal[i])
+                        p_->pipeOutInfos.push_back(info);
+                }
+            }
+
+            // runPipeline() blocks on the workers: below the caller's priority any
+            // normal-priority load would preempt them and stall the audio thread
+            int policy = SCHED_OTHER;
+            struct sched_param param = {};
+            if (p_->pipePriority < 0)
+                pthread_getschedparam(pthread_self(), &policy, &param);
+            else if (p_->pipePriority > 0)
+            {
+                policy = SCHED_FIFO;
+                param.sched_priority = p_->pipePriority;
+            }
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            for (int cpu : p_->pipeCpus)
+                CPU_SET(cpu, &cpus);
+
+            // the caller runs the first graph of each wave, workers the others
+            for (const auto &wave : p_->pipeWaves)
+                pipe[wave[0]].callerRuns = true;
+            for (uint32_t g = 0; g < numGraphs; ++g)
+            {
+                if (pipe[g].callerRuns)
+                    continue;
+                p_->pipeWorkers.emplace_back(&Impl::pipeWorkerLoop, p_.get(), g);
+                pthread_t handle = p_->pipeWorkers.back().native_handle();
+                if (policy != SCHED_OTHER && pthread_setschedparam(handle, policy, &param) != 0)
+                    logMsg("warning: can't give the pipeline worker of graph %u priority %d (needs rtprio)",
+                           g, param.sched_priority);
+                if (!p_->pipeCpus.empty() && pthread_setaffinity_np(handle, sizeof(cpus), &cpus) != 0)
+                    logMsg("warning: can't pin the pipeline worker of graph %u", g);
+            }
+
+            p_->pipePeriod = p_->pipeDepth;
+            p_->pipeRunning = true;
+            return true;
+        }
+
+        const std::vector<TensorInfo> &QnnModel::pipelineInputs() const
+        {
+            return p_->pipeInInfos;
+        }
+
+        const std::vector<TensorInfo> &QnnModel::pipelineOutputs() const
+        {
+            return p_->pipeOutInfos;
+        }
+
+        uint32_t QnnModel::pipelineLatency() const
+        {
+            return p_->pipeDepth;
+        }
+
+        bool QnnModel::runPipeline(const float *const *inputBuffers, float *const *outputBuffers)
+        {
+            if (!p_->pipeRunning)
+                return false;
+            auto &pipe = p_->pipe;
+            const uint64_t period = p_->pipePeriod;
+
+            size_t k = 0;
+            for (uint32_t g = 0; g < p_->numGraphs; ++g)
+                for (size_t i = 0; i < pipe[g].in.size(); ++i)
+                {
+                    if (pipe[g].srcGraph[i] >= 0)
+                        continue;
+                    auto &ring = pipe[g].inRing[i];
+                    toNative(p_->inInfos[g][i], inputBuffers[k++], ring[Impl::ringSlot(period, ring.size())].data());
+                }
+
+            for (const auto &wave : p_->pipeWaves)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(p_->pipeMutex);
+                    p_->pipePending = (int)wave.size() - 1;
+                    for (size_t w = 1; w < wave.size(); ++w)
+                        ++pipe[wave[w]].go;
+                }
+                if (wave.size() > 1)
+                    p_->pipeGoCv.notify_all();
+                p_->runPipeGraph(wave[0]);
+                std::unique_lock<std::mutex> lock(p_->pipeMutex);
+                p_->pipeDoneCv.wait(lock, [this] { return p_->pipePending == 0; });
+            }
+
+            bool ok = true;
+            for (uint32_t g = 0; g < p_->numGraphs; ++g)
+                if (pipe[g].err != QNN_SUCCESS)
+                {
+                    logMsg("pipeline: graphExecute of graph %u failed (err=%lld)", g, (long long)pipe[g].err);
+                    ok = false;
+                }
+
+            // the pipeline output is the period that has now been through every stage
+            k = 0;
+            for (uint32_t g = 0; g < p_->numGraphs; ++g)
+                for (size_t i = 0; i < pipe[g].out.size(); ++i)
+                {
+                    if (!pipe[g].outExternal[i])
+                        continue;
+                    auto &ring = pipe[g].outRing[i];
+                    fromNative(p_->outInfos[g][i], ring[Impl::ringSlot(period - p_->pipeDepth, ring.size())].data(),
+                               outputBuffers[k++]);
+                }
+            ++p_->pipePeriod;
+            return ok;
+        }
+
+        void QnnModel::stopPipeline()
+        {
+            p_->stopPipeline();
+        }
+
+        bool QnnModel::warmup(uint32_t graphIdx, int n)
+        {
+            if (!p_->loaded || graphIdx >= p_->numGraphs)
+                return false;
+
+            // scratch buffers, zeroed: any finite input will do
+            const auto &inI = p_->inInfos[graphIdx];
+            const auto &outI = p_->outInfos[graphIdx];
+            std::vector<std::vector<float>> ins(inI.size()), outs(outI.size());
+            std::vector<const float *> inPtrs(inI.size());
+            std::vector<float *> outPtrs(outI.size());
+            for (size_t i = 0; i < inI.size(); ++i)
+            {
+                ins[i].assign(inI[i].numElements, 0.f);
+                inPtrs[i] = ins[i].data();
+            }
+            for (size_t i = 0; i < outI.size(); ++i)
+            {
+                outs[i].assign(outI[i].numElements, 0.f);
+                outPtrs[i] = outs[i].data();
+            }
+
+            // the cold run would only skew the stats
+            p_->recordLatency = false;
+            bool ok = n <= 0 || execute(graphIdx, inPtrs.data(), outPtrs.data());
+            p_->recordLatency = true;
+            for (int k = 1; k < n && ok; ++k)
+                ok = execute(graphIdx, inPtrs.data(), outPtrs.data());
+
+            // settle the async path (API or executor thread) before audio starts
+            p_->recordLatency = false;
+            ok = ok && submit(graphIdx, inPtrs.data(), outPtrs.data()) && wait(graphIdx);
+            p_->recordLatency = true;
+            return ok;
+        }
+
+        void QnnModel::setProfiling(ProfilingLevel level)
+        {
+            p_->profilingLevel = level;
+        }
+
+        std::vector<OpProfile> QnnModel::opProfile(uint32_t graphIdx) const
+        {
+            std::vector<OpProfile> ops;
+            if (graphIdx >= p_->opStats.size())
+                return ops;
+            for (const auto &entry : p_->opStats[graphIdx])
+            {
+                OpProfile op = entry.second;
+                op.mean = op.total / (double)op.count;
+                ops.push_back(op);
+            }
+            std::sort(ops.begin(), ops.end(),
+                      [](const OpProfile &a, const OpProfile &b) { return a.total > b.total; });
+            return ops;
+        }
+
+        void QnnModel::printProfile(uint32_t graphIdx) const
+        {
+            std::vector<OpProfile> ops = opProfile(graphIdx);
+            if (ops.empty())
+            {
+                printf("QnnModel profile, graph %u: no data (profiling off or no execute() yet)\n", graphIdx);
+                return;
+            }
+
+            // share of the graph execute time, per unit
+            std::map<std::string, double> graphTotal;
+            for (const auto &op : ops)
+                if (op.name == "<execute>")
+                    graphTotal[op.unit] = op.total;
+
+            printf("QnnModel profile, graph %u:\n", graphIdx);
+            printf("  %-40s %8s %12s %12s %12s %7s\n", "op", "count", "mean", "max", "total", "share");
+            for (const auto &op : ops)
+            {
+                double total = graphTotal.count(op.unit) ? graphTotal[op.unit] : 0.0;
+                printf("  %-40.40s %8zu %12.1f %12.1f %12.0f %6.1f%%  %s\n", op.name.c_str(), op.count,
+                       op.mean, op.max, op.total, total > 0.0 ? 100.0 * op.total / total : 0.0, op.unit.c_str());
+            }
+        }
+
+        bool QnnModel::saveProfile(const std::string &csvPath) const
+        {
+            FILE *f = fopen(csvPath.c_str(), "w");
+            if (!f)
+            {
+                logMsg("unable to write profile '%s'", csvPath.c_str());
+                return false;
+            }
+            fprintf(f, "graph,op,unit,count,total,mean,max\n");
+            for (uint32_t g = 0; g < p_->opStats.size(); ++g)
+                for (const auto &op : opProfile(g))
+                    fprintf(f, "%u,\"%s\",%s,%zu,%.3f,%.3f,%.3f\n", g, op.name.c_str(), op.unit.c_str(),
+                            op.count, op.total, op.mean, op.max);
+            return fclose(f) == 0;
+        }
+
+        void QnnModel::resetProfile()
+        {
+            for (auto &stats : p_->opStats)
+                stats.clear();
+        }
+
+        LatencyStats QnnModel::latencyStats(uint32_t graphIdx) const
+        {
+            if (graphIdx >= p_->latency.size())
+                return LatencyStats();
+            return p_->latency[graphIdx]->stats();
+        }
+
+        void QnnModel::resetLatencyStats()
+        {
+            for (auto &log : p_->latency)
+                log->reset();
+        }
+
+        // =====================================================================
+        // QnnModelVariants
+        // =====================================================================
+
+        struct QnnModelVariants::Impl
+        {
+            std::shared_ptr<QnnRuntime> runtime;
+            std::vector<std::string> modelPaths;
+            ProfilingLevel profilingLevel = ProfilingLevel::Off;
+            // loaded variants, by ascending block size
+            std::vector<std::unique_ptr<QnnModel>> models;
+            std::vector<uint32_t> blockSizes;
+            std::vector<size_t> inFrame, outFrame; // floats per frame, per tensor
+
+            int selected = -1;
+            uint32_t periodSize = 0;
+            uint32_t blocks = 0; // variant runs per period
+            // per-block buffer pointers, sized at load so execute() doesn't allocate
+            std::vector<const float *> inPtrs;
+            std::vector<float *> outPtrs;
+        };
+
+        QnnModelVariants::QnnModelVariants(std::string backendLibPath,
+                                           std::vector<std::string> modelPaths,
+                                           std::string systemLibPath)
+            : p_(new Impl())
+        {
+            p_->runtime = std::make_shared<QnnRuntime>(std::move(backendLibPath), std::move(systemLibPath));
+            p_->modelPaths = std::move(modelPaths);
+        }
+
+        QnnModelVariants::~QnnModelVariants() = default;
+
+        void QnnModelVariants::setProfiling(ProfilingLevel level)
+        {
+            p_->profilingLevel = level;
+        }
+
+        bool QnnModelVariants::load(int logLevel)
+        {
+            if (p_->modelPaths.empty())
+            {
+                logMsg("no model variants given");
+                return false;
+            }
+
+            std::vector<std::pair<uint32_t, std::unique_ptr<QnnModel>>> loaded;
+            for (const std::string &path : p_->modelPaths)
+            {
+                std::unique_ptr<QnnModel> model(new QnnModel(p_->runtime, path));
+                model->setProfiling(p_->profilingLevel);
+                if (!model->load(logLevel))
+                    return false;
+                const auto &in = model->inputs(0);
+                const auto &out = model->outputs(0);
+                if (in.empty() || out.empty() || in[0].dims.empty() || in[0].dims[0] == 0)
+                {
+                    logMsg("variant '%s': no input/output with a leading (frame) dimension", path.c_str());
+                    return false;
+                }
+                uint32_t block = in[0].dims[0];
+                for (const auto *infos : {&in, &out})
+                    for (const TensorInfo &info : *infos)
+                        if (info.dims.empty() || info.dims[0] != block)
+                        {
+                            logMsg("variant '%s': tensor '%s' is not %u frames long",
+                                   path.c_str(), info.name.c_str(), block);
+                            return false;
+                        }
+                for (const auto &other : loaded)
+                    if (other.first == block)
+                    {
+                        logMsg("variant '%s': block size %u already loaded", path.c_str(), block);
+                        return false;
+                    }
+                loaded.emplace_back(block, std::move(model));
+            }
+            std::sort(loaded.begin(), loaded.end(),
+                      [](const std::pair<uint32_t, std::unique_ptr<QnnModel>> &a,
+                         const std::pair<uint32_t, std::unique_ptr<QnnModel>> &b) { return a.first < b.first; });
+
+            // every variant must be the same model, frame for frame
+            auto frameSizes = [](const std::vector<TensorInfo> &infos, std::vector<size_t> &frames)
+            {
+                frames.resize(infos.size());
+                for (size_t i = 0; i < infos.size(); ++i)
+                    frames[i] = infos[i].numElements / infos[i].dims[0];
+            };
+            frameSizes(loaded[0].second->inputs(0), p_->inFrame);
+            frameSizes(loaded[0].second->outputs(0), p_->outFrame);
+            for (size_t v = 1; v < loaded.size(); ++v)
+            {
+                std::vector<size_t> inFrame, outFrame;
+                frameSizes(loaded[v].second->inputs(0), inFrame);
+                frameSizes(loaded[v].second->outputs(0), outFrame);
+                if (inFrame != p_->inFrame || outFrame != p_->outFrame)
+                {
+                    logMsg("variants with block sizes %u and %u have different per-frame I/O",
+                           loaded[0].first, loaded[v].first);
+                    return false;
+                }
+            }
+
+            p_->models.clear();
+            p_->blockSizes.clear();
+            for (auto &v : loaded)
+            {
+                p_->blockSizes.push_back(v.first);
+                p_->models.push_back(std::move(v.second));
+            }
+            p_->inPtrs.assign(p_->inFrame.size(), nullptr);
+            p_->outPtrs.assign(p_->outFrame.size(), nullptr);
+            p_->selected = -1;
+            p_->periodSize = 0;
+            p_->blocks = 0;
+            return true;
+        }
+
+        std::vector<uint32_t> QnnModelVariants::blockSizes() const
+        {
+            return p_->blockSizes;
+        }
+
+        bool QnnModelVariants::select(uint32_t periodSize)
+        {
+            // largest block size dividing the period; the exact one if there is one
+            for (size_t v = p_->blockSizes.size(); v-- > 0;)
+            {
+                uint32_t block = p_->blockSizes[v];
+                if (block <= periodSize && periodSize % block == 0)
+                {
+                    p_->selected = (int)v;
+                    p_->periodSize = periodSize;
+                    p_->blocks = periodSize / block;
+                    return true;
+                }
+            }
+            logMsg("no model variant fits a period of %u frames", periodSize);
+            return false;
+        }
+
+        uint32_t QnnModelVariants::periodSize() const
+        {
+            return p_->periodSize;
+        }
+
+        uint32_t QnnModelVariants::blockSize() const
+        {
+            return p_->selected < 0 ? 0 : p_->blockSizes[p_->selected];
+        }
+
+        const std::vector<TensorInfo> &QnnModelVariants::inputs() const
+        {
+            return p_->models.at(p_->selected)->inputs(0);
+        }
+
+        const std::vector<TensorInfo> &QnnModelVariants::outputs() const
+        {
+            return p_->models.at(p_->selected)->outputs(0);
+        }
+
+        size_t QnnModelVariants::inputFrameSize(size_t i) const
+        {
+            return p_->inFrame.at(i);
+        }
+
+        size_t QnnModelVariants::outputFrameSize(size_t i) const
+        {
+            return p_->outFrame.at(i);
+        }
+
+        bool QnnModelVariants::execute(const float *const *inputBuffers, float *const *outputBuffers)
+        {
+            if (p_->selected < 0)
+                return false;
+            QnnModel &model = *p_->models[p_->selected];
+            if (p_->blocks == 1)
+                return model.execute(0, inputBuffers, outputBuffers);
+
+            const size_t block = p_->blockSizes[p_->selected];
+            for (uint32_t b = 0; b < p_->blocks; ++b)
+            {
+                for (size_t i = 0; i < p_->inPtrs.size(); ++i)
+                    p_->inPtrs[i] = inputBuffers[i] + b * block * p_->inFrame[i];
+                for (size_t i = 0; i < p_->outPtrs.size(); ++i)
+                    p_->outPtrs[i] = outputBuffers[i] + b * block * p_->outFrame[i];
+                if (!model.execute(0, p_->inPtrs.data(), p_->outPtrs.data()))
+                    return false;
+            }
+            return true;
+        }
+
+        bool QnnModelVariants::warmup(int n)
+        {
+            return p_->selected >= 0 && p_->models[p_->selected]->warmup(0, n);
+        }
+
+        QnnModel &QnnModelVariants::selected()
+        {
+            return *p_->models.at(p_->selected);
+        }
+
     } // namespace qnn
 } // namespace ar
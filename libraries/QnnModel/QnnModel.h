@@ -22,20 +22,92 @@
 #include <string>
 #include <vector>
 
+#include "LatencyLog.h"
+
 namespace ar
 {
     namespace qnn
     {
+        // Element type of a graph tensor as stored by the backend. The API is
+        // float32 regardless; other types are converted at the execute() boundary.
+        enum class ElementType
+        {
+            Float32,
+            Float16,
+            UFixed8,  // QNN_DATATYPE_UFIXED_POINT_8
+            SFixed8,  // QNN_DATATYPE_SFIXED_POINT_8
+            UFixed16, // QNN_DATATYPE_UFIXED_POINT_16
+            SFixed16  // QNN_DATATYPE_SFIXED_POINT_16
+        };
+
         // Shape/identity of one graph input or output tensor.
         struct TensorInfo
         {
             std::string name;
             std::vector<uint32_t> dims; // size of each dimension, outermost first
             size_t numElements = 0;     // product of dims
+            ElementType type = ElementType::Float32;
+            // fixed-point types only, as in the tensor's quantize params:
+            // real = (quantized + offset) * scale
+            float scale = 1.f;
+            int32_t offset = 0;
+        };
+
+        // Latency of the recent execute() calls of one graph, in microseconds.
+        using LatencyStats = ar::LatencyStats;
+
+        // QNN profiling level, set before load().
+        enum class ProfilingLevel
+        {
+            Off,
+            Basic,   // whole-graph execute time
+            Detailed // plus per-op (node) times
+        };
+
+        // Aggregated timing of one op (or of the whole graph execute) over the
+        // profiled execute() calls.
+        struct OpProfile
+        {
+            std::string name;
+            std::string unit; // "us" or "cycles", as reported by the backend
+            size_t count = 0;
+            double total = 0.0;
+            double mean = 0.0;
+            double max = 0.0;
+        };
+
+        // The QNN backend and system libraries, log and backend handle. Several
+        // models (or instances of one) can share one runtime, each as its own
+        // context on the same backend, instead of opening and creating all of it
+        // once per model. Models hold a reference, so the runtime is released with
+        // the last of them. Not copyable.
+        class QnnRuntime
+        {
+        public:
+            // backendLibPath: QNN backend library (e.g. libQnnCpu.so / libQnnGpu.so).
+            // systemLibPath:  the QNN System library (libQnnSystem.so).
+            QnnRuntime(std::string backendLibPath, std::string systemLibPath);
+            ~QnnRuntime();
+
+            QnnRuntime(const QnnRuntime &) = delete;
+            QnnRuntime &operator=(const QnnRuntime &) = delete;
+
+            // Load the libraries and create the log + backend. Called by the first
+            // QnnModel::load() if not done before; later calls (and their logLevel)
+            // are no-ops. Returns false on failure (details are logged).
+            bool init(int logLevel = 1);
+
+            const std::string &backendLibPath() const;
+
+        private:
+            friend class QnnModel;
+            struct Impl;
+            std::unique_ptr<Impl> p_;
         };
 
-        // Loads a model and runs its graphs. One instance owns one backend +
-        // context; not copyable. All heavy resources are released in the destructor.
+        // Loads a model and runs its graphs. One instance owns one context, on its
+        // own backend or on a shared QnnRuntime; not copyable. All heavy resources
+        // are released in the destructor.
         class QnnModel
         {
         public:
@@ -43,9 +115,12 @@ namespace ar
             // modelPath:      a ".dlc" (composed at load) or a ".bin" context binary
             //                 (precompiled); the format is chosen from the extension.
             // systemLibPath:  the QNN System library (libQnnSystem.so).
+            // The model gets a runtime of its own.
             QnnModel(std::string backendLibPath,
                      std::string modelPath,
                      std::string systemLibPath);
+            // Same, as one more context on a shared runtime.
+            QnnModel(std::shared_ptr<QnnRuntime> runtime, std::string modelPath);
             ~QnnModel();
 
             QnnModel(const QnnModel &) = delete;
@@ -57,6 +132,28 @@ namespace ar
             // before execute().
             bool load(int logLevel = 1);
 
+            // A .dlc's finalized context is serialized next to it on first load
+            // (<model>.dlc.<backend lib>.ctx.bin) and loaded directly as a context
+            // binary on later load() calls, skipping compose + finalize. It is
+            // rebuilt when the DLC content or the backend library changes. On by
+            // default; call before load() to turn it off (e.g. read-only model dir).
+            void setContextCache(bool enable);
+
+            // Attach a QNN profile handle to every execute() and aggregate its
+            // events per graph. Diagnostic only: reading the events after each run
+            // costs time (and allocates for each new op), so leave it Off in
+            // production. submit() runs are not profiled. Call before load().
+            void setProfiling(ProfilingLevel level);
+            // Ops of a graph sorted by total time, most expensive first; the whole
+            // graph execute is reported as "<execute>".
+            std::vector<OpProfile> opProfile(uint32_t graphIdx = 0) const;
+            // Print opProfile() as a table to stdout / save it as CSV (graph, op,
+            // unit, count, total, mean, max). saveProfile() returns false on I/O
+            // errors. Query outside the audio thread.
+            void printProfile(uint32_t graphIdx = 0) const;
+            bool saveProfile(const std::string &csvPath) const;
+            void resetProfile();
+
             uint32_t numGraphs() const;
 
             // I/O tensor descriptors for a graph (valid after a successful load()).
@@ -66,11 +163,147 @@ namespace ar
             // Run one graph: inputBuffers[i] feeds input i (sized to
             // inputs(graphIdx)[i].numElements floats), outputBuffers[i] receives
             // output i (sized to outputs(graphIdx)[i].numElements floats). Buffers
-            // are float32. Returns false on failure.
+            // are float32: float32 tensors are zero-copy, fp16 and fixed-point ones
+            // go through native buffers allocated at load, (de)quantized with NEON.
+            // Returns false on failure.
             bool execute(uint32_t graphIdx,
                          const float *const *inputBuffers,
                          float *const *outputBuffers);
 
+            // ----- asynchronous execution ---------------------------------------
+            // submit() starts graphIdx on the given buffers and returns at once; the
+            // buffers belong to the model until the matching wait() returns. Each
+            // graph has two submission slots, so the next period's inputs can be
+            // prepared (and submitted) while the previous one is still in flight:
+            // e.g. wait() for block N at the top of render(), submit block N+1 at
+            // the end, and the graph runs during the rest of the callback and the
+            // PCM wait. Uses graphExecuteAsync when the backend supports it, or a
+            // dedicated executor thread otherwise. Don't mix with execute() on a
+            // graph with submissions in flight. submit() returns false if both
+            // slots are busy or on failure.
+            bool submit(uint32_t graphIdx,
+                        const float *const *inputBuffers,
+                        float *const *outputBuffers);
+            // true when the oldest submission of graphIdx has completed (never blocks)
+            bool poll(uint32_t graphIdx) const;
+            // Blocks until the oldest submission of graphIdx completes; its outputs
+            // are then in its output buffers. Returns false if nothing was in
+            // flight or the execution failed. Latency stats record submit-to-done.
+            bool wait(uint32_t graphIdx);
+
+            // ----- multi-graph pipelines ----------------------------------------
+            // For models split into several graphs (encoder/decoder, parallel
+            // branches). connect() feeds output srcOutput of srcGraph into input
+            // dstInput of dstGraph; both sides must have the same size, type and
+            // quantization, and share one buffer (no copy, no conversion). Call
+            // after load(), before startPipeline(); returns false on a mismatch.
+            bool connect(uint32_t srcGraph, uint32_t srcOutput, uint32_t dstGraph, uint32_t dstInput);
+            // Plan the pipeline from the connections and start one worker thread
+            // per graph that can run alongside another. A graph's stage is the
+            // longest chain of graphs feeding it. pipelined: stage s processes the
+            // data of s periods ago, so all graphs run concurrently and a period
+            // costs the slowest graph, not their sum, for pipelineLatency() periods
+            // of delay. Otherwise the stages run in order within each period (the
+            // graphs of one stage still concurrently) with no delay. Fails on
+            // cycles.
+            bool startPipeline(bool pipelined = true);
+            // Scheduling of the pipeline workers, applied by startPipeline().
+            // runPipeline() waits for them, so they must not run below the caller:
+            // by default (priority < 0) they take the policy and priority of the
+            // thread calling startPipeline(), i.e. SCHED_FIFO when called from
+            // setup() on the audio thread. priority > 0 makes them SCHED_FIFO at
+            // that priority, 0 leaves them SCHED_OTHER. cpus, if not empty, pins
+            // every worker to those CPUs. Call before startPipeline().
+            void setPipelineScheduling(int priority, const std::vector<int> &cpus = {});
+            // The pipeline's external I/O: the unconnected inputs / outputs of all
+            // graphs, in graph then tensor order; runPipeline() buffers follow it.
+            const std::vector<TensorInfo> &pipelineInputs() const;
+            const std::vector<TensorInfo> &pipelineOutputs() const;
+            // periods between an input and its output in runPipeline()
+            uint32_t pipelineLatency() const;
+            // Run one period: inputBuffers are this period's, outputBuffers receive
+            // the period of pipelineLatency() calls ago (silence-driven at first).
+            // Float32 like execute(). Each graph's run is timed into its
+            // latencyStats(). Don't mix with execute()/submit() while started.
+            bool runPipeline(const float *const *inputBuffers, float *const *outputBuffers);
+            // Join the workers; connections are kept, so startPipeline() can run again.
+            void stopPipeline();
+
+            // Run a graph n times on zeroed buffers (results discarded), so the
+            // backend's lazy initialization happens now rather than in the first
+            // audio period. All runs but the first (cold) one are recorded, so
+            // latencyStats() right after tells whether the graph fits the period
+            // budget. It ends with one unrecorded submit()/wait(), which also sets
+            // up the asynchronous path (and its thread, if any). Returns false on
+            // failure.
+            bool warmup(uint32_t graphIdx = 0, int n = 8);
+
+            // Every execute() is timed. Stats cover the last kLatencyWindow calls of
+            // a graph; computing them sorts a copy, so query outside the audio thread.
+            // That is safe while the audio thread executes (see LatencyLog.h), but
+            // reset only while it doesn't.
+            static const size_t kLatencyWindow = LatencyLog::window;
+            LatencyStats latencyStats(uint32_t graphIdx = 0) const;
+            void resetLatencyStats();
+
+        private:
+            bool loadModel(int logLevel);
+
+            struct Impl;
+            std::unique_ptr<Impl> p_;
+        };
+
+        // A family of fixed-shape variants of one model, one per block size, e.g.
+        // model_256x2.dlc + model_512x2.dlc. A variant's block size is the leading
+        // dimension of its tensors (frames); all variants must agree on everything
+        // else. They are loaded as contexts on one shared QnnRuntime, and select()
+        // picks how to run the active period: on the variant of that exact size,
+        // or else as consecutive blocks of the largest variant that divides it.
+        // The latter assumes frames are independent along the leading dimension
+        // (as in a per-sample model). Runs graph 0 of each variant; not copyable.
+        class QnnModelVariants
+        {
+        public:
+            QnnModelVariants(std::string backendLibPath,
+                             std::vector<std::string> modelPaths,
+                             std::string systemLibPath);
+            ~QnnModelVariants();
+
+            QnnModelVariants(const QnnModelVariants &) = delete;
+            QnnModelVariants &operator=(const QnnModelVariants &) = delete;
+
+            // QnnModel::setProfiling for every variant; call before load()
+            void setProfiling(ProfilingLevel level);
+
+            // Load every variant (see QnnModel::load) and check that they match.
+            // Returns false on any failure (details are logged).
+            bool load(int logLevel = 1);
+
+            // block sizes of the loaded variants, ascending
+            std::vector<uint32_t> blockSizes() const;
+
+            // Choose the variant(s) for periods of periodSize frames; false if no
+            // variant fits (nothing is changed then). Not real-time safe: call it
+            // when the period changes, then warmup().
+            bool select(uint32_t periodSize);
+            uint32_t periodSize() const;
+            // block size of the selected variant: periodSize() / blocks per period
+            uint32_t blockSize() const;
+
+            // I/O of the selected variant, per block
+            const std::vector<TensorInfo> &inputs() const;
+            const std::vector<TensorInfo> &outputs() const;
+            // floats per frame of input/output i (numElements / block size)
+            size_t inputFrameSize(size_t i) const;
+            size_t outputFrameSize(size_t i) const;
+
+            // Run one period, like QnnModel::execute, with buffers of periodSize()
+            // frames each.
+            bool execute(const float *const *inputBuffers, float *const *outputBuffers);
+            // QnnModel::warmup / latencyStats of the selected variant
+            bool warmup(int n = 8);
+            QnnModel &selected();
+
         private:
             struct Impl;
             std::unique_ptr<Impl> p_;
@@ -0,0 +1,180 @@
+/*
+ * Copyright 2026 Victor Zappi, Gautham Srinivasan
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+// RTNeuralBlock: run a stateless feed-forward RTNeural model on a whole block of
+// frames at once.
+//
+// RTNeural's forward() takes one frame, so each Dense layer is a matrix-vector
+// product per sample and its weights are streamed from memory again for every
+// frame of the period. Here the block is packed into a matrix (one column per
+// frame) and every Dense layer becomes a single GEMM, weights + bias applied to
+// all frames; activations run element-wise over the whole block, vectorized by
+// Eigen. The arithmetic per frame is the same as forward()'s.
+//
+// Only layers without state across frames fit (Dense + activations); recurrent
+// or convolutional models still need RTNeural's per-frame forward(). Header-only;
+// uses Eigen whichever backend RTNeural is built with.
+
+#pragma once
+
+#include <RTNeural/RTNeural.h>
+#include <Eigen/Dense>
+
+#include <string>
+#include <vector>
+
+namespace ar
+{
+    namespace rtneural
+    {
+        enum class Activation
+        {
+            None,
+            ReLu,
+            Tanh,
+            Sigmoid
+        };
+
+        template <typename T>
+        class BlockModel
+        {
+        public:
+            using Matrix = Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>;
+            using Vector = Eigen::Matrix<T, Eigen::Dynamic, 1>;
+
+            // Append a Dense layer (inSize -> outSize) followed by an activation.
+            // Layers are indexed in the order they are added.
+            void addDense(int inSize, int outSize, Activation activation = Activation::None)
+            {
+                Layer layer;
+                layer.weights = Matrix::Zero(outSize, inSize);
+                layer.bias = Vector::Zero(outSize);
+                layer.activation = activation;
+                layers.push_back(layer);
+            }
+
+            // Load a layer's weights from a PyTorch state dict exported to JSON, as
+            // RTNeural::torch_helpers::loadDense does (prefix + "weight", an
+            // [outSize][inSize] array, and prefix + "bias"). False on a size mismatch.
+            bool loadDense(const nlohmann::json &modelJson, size_t layerIdx, const std::string &prefix)
+            {
+                if (layerIdx >= layers.size())
+                    return false;
+                Layer &layer = layers[layerIdx];
+                const auto weights = modelJson.at(prefix + "weight").template get<std::vector<std::vector<T>>>();
+                const auto bias = modelJson.at(prefix + "bias").template get<std::vector<T>>();
+                if ((Eigen::Index)weights.size() != layer.weights.rows() ||
+                    (Eigen::Index)bias.size() != layer.bias.size())
+                    return false;
+                for (size_t o = 0; o < weights.size(); ++o)
+                {
+                    if ((Eigen::Index)weights[o].size() != layer.weights.cols())
+                        return false;
+                    for (size_t i = 0; i < weights[o].size(); ++i)
+                        layer.weights((Eigen::Index)o, (Eigen::Index)i) = weights[o][i];
+                    layer.bias((Eigen::Index)o) = bias[o];
+                }
+                return true;
+            }
+
+            // Set a layer's weights from arrays, e.g. those embed_weights.cmake
+            // generates from the model JSON at build time: weights row-major
+            // [outSize][inSize], as in the state dict. Sizes are the layer's own. The
+            // arrays are copied: the layer matrices stay dynamic.
+            void setDense(size_t layerIdx, const T *weights, const T *bias)
+            {
+                Layer &layer = layers.at(layerIdx);
+                layer.weights = Eigen::Map<const Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>(
+                    weights, layer.weights.rows(), layer.weights.cols());
+                layer.bias = Eigen::Map<const Vector>(bias, layer.bias.size());
+            }
+
+            // Allocate the intermediate block buffers for up to maxFrames frames per
+            // process() call. Call after the last addDense(), outside the audio thread.
+            void prepare(int maxFrames)
+            {
+                this->maxFrames = maxFrames;
+                for (Layer &layer : layers)
+                    layer.outs = Matrix::Zero(layer.weights.rows(), maxFrames);
+            }
+
+            int getInputSize() const { return layers.empty() ? 0 : (int)layers.front().weights.cols(); }
+            int getOutputSize() const { return layers.empty() ? 0 : (int)layers.back().weights.rows(); }
+
+            // Run frames frames. Buffers are frame-interleaved: frame n of the input
+            // is input[n * getInputSize() ...], same for the output. Doesn't allocate
+            // once prepare() has sized the block buffers; more than maxFrames frames
+            // are run in chunks of maxFrames (frames are independent). Does nothing
+            // before prepare().
+            void process(const T *input, T *output, int frames)
+            {
+                if (maxFrames <= 0 || layers.empty())
+                    return;
+                while (frames > maxFrames)
+                {
+                    processBlock(input, output, maxFrames);
+                    input += (size_t)maxFrames * getInputSize();
+                    output += (size_t)maxFrames * getOutputSize();
+                    frames -= maxFrames;
+                }
+                if (frames > 0)
+                    processBlock(input, output, frames);
+            }
+
+        private:
+            // frames <= maxFrames
+            void processBlock(const T *input, T *output, int frames)
+            {
+                Eigen::Map<const Matrix> in(input, getInputSize(), frames);
+                const Matrix *prev = nullptr;
+                for (size_t l = 0; l < layers.size(); ++l)
+                {
+                    Layer &layer = layers[l];
+                    auto outs = layer.outs.leftCols(frames);
+                    // one GEMM for the whole block, then the bias down every column
+                    if (prev)
+                        outs.noalias() = layer.weights * prev->leftCols(frames);
+                    else
+                        outs.noalias() = layer.weights * in;
+                    outs.colwise() += layer.bias;
+                    activate(outs, layer.activation);
+                    prev = &layer.outs;
+                }
+                Eigen::Map<Matrix>(output, getOutputSize(), frames) = prev->leftCols(frames);
+            }
+
+            struct Layer
+            {
+                Matrix weights; // outSize x inSize
+                Vector bias;
+                Activation activation = Activation::None;
+                Matrix outs; // outSize x maxFrames
+            };
+
+            template <typename Block>
+            static void activate(Block &&x, Activation activation)
+            {
+                switch (activation)
+                {
+                case Activation::ReLu:
+                    x = x.cwiseMax((T)0);
+                    break;
+                case Activation::Tanh:
+                    x = x.array().tanh().matrix();
+                    break;
+                case Activation::Sigmoid:
+                    x = ((T)1 / ((T)1 + (-x.array()).exp())).matrix();
+                    break;
+                default:
+                    break;
+                }
+            }
+
+            std::vector<Layer> layers;
+            int maxFrames = 0;
+        };
+
+    } // namespace rtneural
+} // namespace ar
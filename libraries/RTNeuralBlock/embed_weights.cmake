@@ -0,0 +1,177 @@
+# Converts a PyTorch state dict of dense layers, exported to JSON (as loaded by
+# RTNeural::torch_helpers::loadDense or BlockModel::loadDense), into a C++ header
+# of aligned constexpr weight arrays, so the model needs no JSON parsing at
+# startup. The arrays are only constant at compile time: BlockModel::setDense
+# copies them into its (dynamic) matrices.
+#
+# cmake -DINPUT=model.json -DOUTPUT=model_weights.h -DNAMESPACE=model_weights
+#       [-DLAYERS=fc1.,fc2.,fc3.] -P embed_weights.cmake
+#
+# Every "<layer>weight" ([out][in]) / "<layer>bias" ([out]) pair becomes, in
+# namespace NAMESPACE (with <layer> made an identifier, e.g. "input_layer."
+# -> input_layer):
+#   constexpr int <layer>_in, <layer>_out;
+#   alignas(16) constexpr float <layer>_weight[out * in];  // row-major [out][in]
+#   alignas(16) constexpr float <layer>_bias[out];
+# plus layers[numLayers] describing them, in network order. That is the order of
+# the prefixes in LAYERS (comma-separated) if given. Otherwise the layers are
+# chained by size, since string(JSON) returns the keys sorted (fc10. before fc2.,
+# output_ before input_): the first layer is the one whose input no other layer
+# produces, and each next one takes the previous one's output. Ties (equal hidden
+# sizes) go to the lowest prefix, numbers compared by value. This is the
+# reference for that rule: rtneural_bench runs the embedded model in the order
+# of layers[], and applies the rule at run time only to models not embedded.
+# Needs CMake 3.19 (string(JSON)).
+
+cmake_minimum_required(VERSION 3.19)
+
+foreach(VAR INPUT OUTPUT NAMESPACE)
+    if(NOT ${VAR})
+        message(FATAL_ERROR "embed_weights.cmake: ${VAR} is not set")
+    endif()
+endforeach()
+
+file(READ "${INPUT}" MODEL_JSON)
+string(JSON NUM_KEYS LENGTH "${MODEL_JSON}")
+if(NUM_KEYS EQUAL 0)
+    message(FATAL_ERROR "embed_weights.cmake: '${INPUT}' has no entries")
+endif()
+
+# JSON array text -> comma-separated numbers, flattened row-major
+function(flatten_array ARRAY_JSON OUT_VALUES OUT_COUNT)
+    string(REGEX REPLACE "[][ \t\r\n]" "" VALUES "${ARRAY_JSON}")
+    string(REPLACE "," ";" VALUE_LIST "${VALUES}")
+    list(LENGTH VALUE_LIST COUNT)
+    # 8 values per line keeps the generated header readable
+    set(LINES "")
+    set(LINE "")
+    set(N 0)
+    foreach(VALUE IN LISTS VALUE_LIST)
+        string(APPEND LINE "${VALUE}, ")
+        math(EXPR N "${N} + 1")
+        if(N EQUAL 8)
+            string(APPEND LINES "        ${LINE}\n")
+            set(LINE "")
+            set(N 0)
+        endif()
+    endforeach()
+    if(NOT LINE STREQUAL "")
+        string(APPEND LINES "        ${LINE}\n")
+    endif()
+    set(${OUT_VALUES} "${LINES}" PARENT_SCOPE)
+    set(${OUT_COUNT} ${COUNT} PARENT_SCOPE)
+endfunction()
+
+get_filename_component(INPUT_NAME "${INPUT}" NAME)
+set(HEADER "// Generated from ${INPUT_NAME} by embed_weights.cmake, do not edit.\n\n")
+string(APPEND HEADER "#pragma once\n\nnamespace ${NAMESPACE}\n{\n")
+string(APPEND HEADER "    struct DenseLayer\n    {\n        const char *name; // key prefix in the state dict\n")
+string(APPEND HEADER "        int inSize, outSize;\n        const float *weights; // row-major [outSize][inSize]\n        const float *bias;\n    };\n\n")
+
+# dense layers: every <prefix>weight with a <prefix>bias
+set(PREFIXES "")
+math(EXPR LAST_KEY "${NUM_KEYS} - 1")
+foreach(K RANGE ${LAST_KEY})
+    string(JSON KEY MEMBER "${MODEL_JSON}" ${K})
+    if(NOT KEY MATCHES "^(.*)weight$")
+        continue()
+    endif()
+    set(PREFIX "${CMAKE_MATCH_1}")
+    string(JSON BIAS_JSON ERROR_VARIABLE NO_BIAS GET "${MODEL_JSON}" "${PREFIX}bias")
+    if(NO_BIAS)
+        continue()
+    endif()
+    string(JSON WEIGHT_JSON GET "${MODEL_JSON}" "${KEY}")
+    string(JSON OUT_SIZE_${PREFIX} LENGTH "${WEIGHT_JSON}")
+    string(JSON IN_SIZE_${PREFIX} LENGTH "${WEIGHT_JSON}" 0)
+    list(APPEND PREFIXES "${PREFIX}")
+endforeach()
+
+if(NOT PREFIXES)
+    message(FATAL_ERROR "embed_weights.cmake: '${INPUT}' has no <layer>weight/<layer>bias pairs")
+endif()
+
+# network order
+set(ORDER "")
+if(LAYERS)
+    string(REPLACE "," ";" ORDER "${LAYERS}")
+    foreach(PREFIX IN LISTS ORDER)
+        if(NOT PREFIX IN_LIST PREFIXES)
+            message(FATAL_ERROR "embed_weights.cmake: no layer '${PREFIX}' (${PREFIX}weight / ${PREFIX}bias) in '${INPUT}'")
+        endif()
+    endforeach()
+else()
+    list(SORT PREFIXES COMPARE NATURAL)
+    list(GET PREFIXES 0 FIRST)
+    foreach(PREFIX IN LISTS PREFIXES)
+        set(FED FALSE)
+        foreach(OTHER IN LISTS PREFIXES)
+            if(NOT OTHER STREQUAL PREFIX AND OUT_SIZE_${OTHER} EQUAL IN_SIZE_${PREFIX})
+                set(FED TRUE)
+            endif()
+        endforeach()
+        if(NOT FED)
+            set(FIRST "${PREFIX}")
+            break()
+        endif()
+    endforeach()
+    set(REMAINING ${PREFIXES})
+    list(REMOVE_ITEM REMAINING "${FIRST}")
+    set(ORDER "${FIRST}")
+    set(LAST "${FIRST}")
+    while(REMAINING)
+        set(NEXT "")
+        foreach(PREFIX IN LISTS REMAINING)
+            if(IN_SIZE_${PREFIX} EQUAL OUT_SIZE_${LAST})
+                set(NEXT "${PREFIX}")
+                break()
+            endif()
+        endforeach()
+        if(NEXT STREQUAL "")
+            list(GET REMAINING 0 PREFIX)
+            message(FATAL_ERROR "embed_weights.cmake: can't chain layer '${PREFIX}' after '${LAST}' in '${INPUT}', pass the order in LAYERS")
+        endif()
+        list(APPEND ORDER "${NEXT}")
+        list(REMOVE_ITEM REMAINING "${NEXT}")
+        set(LAST "${NEXT}")
+    endwhile()
+endif()
+
+set(LAYER_ENTRIES "")
+set(NUM_LAYERS 0)
+set(LAST "")
+foreach(PREFIX IN LISTS ORDER)
+    set(OUT_SIZE ${OUT_SIZE_${PREFIX}})
+    set(IN_SIZE ${IN_SIZE_${PREFIX}})
+    if(NOT LAST STREQUAL "" AND NOT IN_SIZE EQUAL OUT_SIZE_${LAST})
+        message(FATAL_ERROR "embed_weights.cmake: layer '${PREFIX}' doesn't take the output of '${LAST}'")
+    endif()
+    set(LAST "${PREFIX}")
+    string(JSON WEIGHT_JSON GET "${MODEL_JSON}" "${PREFIX}weight")
+    string(JSON BIAS_JSON GET "${MODEL_JSON}" "${PREFIX}bias")
+
+    flatten_array("${WEIGHT_JSON}" WEIGHT_VALUES WEIGHT_COUNT)
+    flatten_array("${BIAS_JSON}" BIAS_VALUES BIAS_COUNT)
+    math(EXPR EXPECTED "${OUT_SIZE} * ${IN_SIZE}")
+    if(NOT WEIGHT_COUNT EQUAL EXPECTED OR NOT BIAS_COUNT EQUAL OUT_SIZE)
+        message(FATAL_ERROR "embed_weights.cmake: layer '${PREFIX}' is not a dense [${OUT_SIZE}][${IN_SIZE}] layer")
+    endif()
+
+    string(REGEX REPLACE "[^A-Za-z0-9_]" "_" ID "${PREFIX}")
+    string(REGEX REPLACE "_+$" "" ID "${ID}")
+    if(ID MATCHES "^[0-9]")
+        set(ID "layer_${ID}")
+    endif()
+
+    string(APPEND HEADER "    constexpr int ${ID}_in = ${IN_SIZE};\n    constexpr int ${ID}_out = ${OUT_SIZE};\n")
+    string(APPEND HEADER "    alignas(16) constexpr float ${ID}_weight[${EXPECTED}] = {\n${WEIGHT_VALUES}    };\n")
+    string(APPEND HEADER "    alignas(16) constexpr float ${ID}_bias[${OUT_SIZE}] = {\n${BIAS_VALUES}    };\n\n")
+    string(APPEND LAYER_ENTRIES "        {\"${PREFIX}\", ${ID}_in, ${ID}_out, ${ID}_weight, ${ID}_bias},\n")
+    math(EXPR NUM_LAYERS "${NUM_LAYERS} + 1")
+endforeach()
+
+string(APPEND HEADER "    constexpr int numLayers = ${NUM_LAYERS};\n")
+string(APPEND HEADER "    constexpr DenseLayer layers[numLayers] = {\n${LAYER_ENTRIES}    };\n")
+string(APPEND HEADER "} // namespace ${NAMESPACE}\n")
+
+file(WRITE "${OUTPUT}" "${HEADER}")
@@ -19,14 +19,26 @@
  * https://freesound.org/s/715794/ -- License: Creative Commons 0
  * The original file has been normalized, exported as a mono track
  * and resampled at 48 kHz.
+ *
+ * While it plays, type the path of another .nam file and press enter to switch
+ * to it: the model is loaded and prewarmed in the background (ModelSwap) and
+ * crossfaded in over crossfadeMs, without interrupting the audio.
  */
 
 #include "render.h"
 #include "MonoFilePlayer.h"
 #include "NAM/get_dsp.h"
+#include "ModelSwap.h"
+#include <atomic>
+#include <errno.h>
 #include <filesystem>
 #include <chrono>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
 #include <string>
+#include <thread>
+#include <unistd.h>
 
 
 // by default, all files must be in the same location from where the executable is launched
@@ -39,16 +51,94 @@ std::string modelFilePath = "./Full Rig Peavey 5150 No boost Mesa OS SM57 - jp_i
 
 float volume = 0.75;
 
+// crossfade between the old and the new model when switching
+float crossfadeMs = 50;
+
 //------------------------------------
 
 MonoFilePlayer player;
-std::unique_ptr<nam::DSP> model;
+ar::ModelSwap<nam::DSP, double> modelSwap;
+
+// reads model paths from stdin and requests the swaps
+std::thread controlThread;
+std::atomic<bool> controlRunning{false};
 
 // Buffers for block-based NAM processing
 double *inputBuffer = nullptr;
 double *outputBuffer = nullptr;
 double *inputPtr = nullptr;
-double *outputPtr = nullptr;
+
+// Load a .nam model and get it ready to run at this rate and block size.
+// Runs in setup() and on ModelSwap's loader thread, never in render()
+static std::unique_ptr<nam::DSP> loadModel(const std::string &path, int sampleRate, int periodSize)
+{
+    std::unique_ptr<nam::DSP> model;
+    try {
+        model = nam::get_dsp(std::filesystem::path(path));
+    } catch (const std::exception &e) {
+        printf("Error loading NAM model '%s': %s\n", path.c_str(), e.what());
+        return nullptr;
+    }
+    if(model == nullptr) {
+        printf("Error loading NAM model '%s'\n", path.c_str());
+        return nullptr;
+    }
+
+    // Initialize the model with sample rate and block size
+    model->Reset(sampleRate, periodSize);
+    model->prewarm();
+    return model;
+}
+
+static void requestModel(std::string path, int sampleRate, int periodSize)
+{
+    if (!path.empty() && path.back() == '\r')
+        path.pop_back();
+    if (path.empty())
+        return;
+    printf("Switching to NAM model: %s\n", path.c_str());
+    modelSwap.requestSwap([path, sampleRate, periodSize] {
+        return loadModel(path, sampleRate, periodSize);
+    });
+}
+
+static void controlLoop(int sampleRate, int periodSize)
+{
+    // started from setup() on the audio thread: drop its real-time priority
+    struct sched_param normal = {};
+    pthread_setschedparam(pthread_self(), SCHED_OTHER, &normal);
+
+    // stdin is read directly and split into lines here: a buffered reader
+    // (std::cin) could block on a partial line, or hold lines poll() can't see,
+    // and cleanup() could never stop the thread
+    std::string pending;
+    char buffer[256];
+    while (controlRunning) {
+        // wait for input with a timeout, so that cleanup() can stop the thread
+        struct pollfd pfd = {STDIN_FILENO, POLLIN, 0};
+        if (poll(&pfd, 1, 200) <= 0)
+            continue;
+        // poll() said so: returns what's there without blocking
+        ssize_t n = read(STDIN_FILENO, buffer, sizeof(buffer));
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN)
+                continue;
+            break;
+        }
+        if (n == 0) {
+            // stdin closed: a last line without newline still counts
+            requestModel(pending, sampleRate, periodSize);
+            break;
+        }
+        pending.append(buffer, n);
+        size_t start = 0, end;
+        while ((end = pending.find('\n', start)) != std::string::npos) {
+            requestModel(pending.substr(start, end - start), sampleRate, periodSize);
+            start = end + 1;
+        }
+        pending.erase(0, start);
+    }
+}
 
 int setup(struct audio_ctx *ctx, void *user_data) 
 {
@@ -59,15 +149,9 @@ int setup(struct audio_ctx *ctx, void *user_data)
     }
 
     // Load the NAM model from .nam file
-    model = nam::get_dsp(std::filesystem::path(modelFilePath));
-    if(model == nullptr) {
-        printf("Error loading NAM model '%s'\n", modelFilePath.c_str());
+    std::unique_ptr<nam::DSP> model = loadModel(modelFilePath, ctx->sample_rate, ctx->period_size);
+    if(model == nullptr)
         return false;
-    }
-
-    // Initialize the model with sample rate and block size
-    model->Reset(ctx->sample_rate, ctx->period_size);
-    model->prewarm();
 
     printf("NAM model loaded: %s\n", modelFilePath.c_str());
     printf("Sample rate: %d, Block size: %d\n",
@@ -77,7 +161,13 @@ int setup(struct audio_ctx *ctx, void *user_data)
     inputBuffer = new double[ctx->period_size];
     outputBuffer = new double[ctx->period_size];
     inputPtr = inputBuffer;
-    outputPtr = outputBuffer;
+
+    // Later models are loaded in the background and crossfaded in
+    modelSwap.setup(std::move(model), ctx->period_size);
+    modelSwap.setCrossfade((size_t)(crossfadeMs * 0.001f * ctx->sample_rate));
+    controlRunning = true;
+    controlThread = std::thread(controlLoop, (int)ctx->sample_rate, (int)ctx->period_size);
+    printf("Type the path of another .nam model and press enter to switch to it\n");
 
     return 0;
 }
@@ -88,8 +178,11 @@ void render(struct audio_ctx *ctx, void *userData)
     for (unsigned int n=0; n<ctx->period_size; n++)
         inputBuffer[n] = (double)player.process();
 
-    // Process the entire block through NAM (expects double**)
-    model->process(&inputPtr, &outputPtr, ctx->period_size);
+    // Process the entire block through NAM (expects double**); while a new
+    // model fades in, both run and ModelSwap mixes them into outputBuffer
+    modelSwap.process(outputBuffer, ctx->period_size, [&](nam::DSP &m, double *out) {
+        m.process(&inputPtr, &out, ctx->period_size);
+    });
 
     /*
     static int printCounter = 0;
@@ -114,7 +207,10 @@ void render(struct audio_ctx *ctx, void *userData)
 
 void cleanup(struct audio_ctx *context, void *userData)
 {
+    controlRunning = false;
+    if (controlThread.joinable())
+        controlThread.join();
+    modelSwap.reset();
     delete[] inputBuffer;
     delete[] outputBuffer;
-    model.reset();
 }
\ No newline at end of file
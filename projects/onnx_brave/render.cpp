@@ -28,7 +28,6 @@
 
 #include "render.h"
 #include "OrtModel.h"
-#include <cstring>  // memcpy
 #include <cmath>
 #include <chrono>
 
@@ -57,7 +56,7 @@ const float lfoPhase0[N_PCA] = { 0.0f,  M_PI * 0.5f, M_PI, M_PI * 1.5f };  // st
 float lfoPhase[N_PCA]        = { 0.0f, 0.0f, 0.0f, 0.0f };
 float lfoPhaseInc[N_PCA]     = { 0.0f, 0.0f, 0.0f, 0.0f };  // computed in setup
 
-// ── Inference buffers (allocated in setup) ───────────────────────────────────
+// ── Inference buffers (allocated in setup, bound to the model zero-copy) ───────
 size_t numInputs  = 0;
 size_t numOutputs = 0;
 float** inputs  = nullptr;
@@ -72,35 +71,54 @@ int setup(struct audio_ctx *context, void *userData)
     std::string modelPath = "./" + modelName + ".onnx";
     if (!model.setup("brave_pca_dec", modelPath, false)) {
         printf("Error: unable to load model %s\n", modelPath.c_str());
-        return false;
+        return -1;
     }
 
     // Check period size
     if (context->period_size % BRAVE_BLOCK != 0) {
         printf("Error: period size (%d) must be a multiple of BRAVE_BLOCK (%d)!\n",
                context->period_size, BRAVE_BLOCK);
-        return false;
+        return -1;
     }
 
     // Allocate I/O buffers based on model metadata
     numInputs  = model.getNumInputs();
     numOutputs = model.getNumOutputs();
 
-    inputs  = new float*[numInputs];
-    outputs = new float*[numOutputs];
+    inputs  = new float*[numInputs]();
+    outputs = new float*[numOutputs]();
 
-    for (size_t i = 0; i < numInputs; i++) {
-        size_t sz = model.getInputSize(i);
-        inputs[i] = new float[sz];
-        std::memset(inputs[i], 0, sz * sizeof(float));
+    // cache output c feeds cache input c of the next frame: the model keeps them
+    // as ping-pong state, so only the pca input and the audio output are ours
+    for (size_t c = 1; c < numInputs; c++) {
+        if (!model.addState(c, c)) {
+            printf("Error: cache %zu cannot be carried over as state\n", c);
+            return -1;
+        }
     }
-    
-    for (size_t i = 0; i < numOutputs; i++) {
-        size_t sz = model.getOutputSize(i);
-        outputs[i] = new float[sz];
-        std::memset(outputs[i], 0, sz * sizeof(float));
+
+    // aligned and zeroed; the model reads/writes these directly (runBound)
+    inputs[0] = OrtModel::allocBuffer(model.getInputSize(0));
+    outputs[0] = OrtModel::allocBuffer(model.getOutputSize(0));
+    if (!inputs[0] || !outputs[0]) {
+        printf("Error: unable to allocate I/O buffers\n");
+        return -1;
     }
 
+    // Warm up on the real buffers (so runBound's bindings exist too) and check the
+    // steady-state latency against the block budget before audio starts
+    if (!model.warmup(16, inputs, outputs)) {
+        printf("Error: warm-up inference failed\n");
+        return -1;
+    }
+    OrtModel::LatencyStats lat = model.getLatencyStats();
+    float blockBudgetUs = (float)BRAVE_BLOCK / (float)context->sample_rate * 1e6f;
+    printf("Inference latency (warm-up): min %.0f us | p50 %.0f us | p99 %.0f us | max %.0f us | budget %.0f us\n",
+           lat.minUs, lat.p50Us, lat.p99Us, lat.maxUs, blockBudgetUs);
+    if (lat.p99Us > blockBudgetUs)
+        printf("Warning: p99 inference latency exceeds the block budget, expect underruns\n");
+    model.resetLatencyStats();
+
     // Compute per-period LFO phase increments and seed initial phases
     for (int i = 0; i < N_PCA; i++) {
         lfoPhaseInc[i] = 2.0f * (float)M_PI * lfoRates[i]
@@ -110,6 +128,7 @@ int setup(struct audio_ctx *context, void *userData)
 
     printf("BRAVE PCA decoder ready\n");
     printf("  Inputs : %zu (pca[%d] + %zu caches)\n", numInputs, N_PCA, numInputs - 1);
+    printf("  State  : %zu floats, carried over without copies\n", model.getStateSize());
     printf("  Outputs: %zu (audio[%d] + %zu caches)\n", numOutputs, BRAVE_BLOCK, numOutputs - 1);
     printf("  Period : %d samples (%d inferences per period)\n",
            context->period_size, context->period_size / BRAVE_BLOCK);
@@ -148,7 +167,7 @@ void render(struct audio_ctx *ctx, void *userData)
 #ifdef PROFILE_INFERENCE
         auto t0 = std::chrono::high_resolution_clock::now();
 #endif
-        model.run(inputs, outputs);
+        model.runBound(inputs, outputs);
 #ifdef PROFILE_INFERENCE
         auto t1 = std::chrono::high_resolution_clock::now();
         float inferUs = std::chrono::duration<float, std::micro>(t1 - t0).count();
@@ -169,11 +188,6 @@ void render(struct audio_ctx *ctx, void *userData)
             ctx->audio_buffer[(ctx->channels * (offset + i)) + 1] = outputs[0][i];
         }
 
-        // ── Copy output caches → input caches for next frame ─────────────────
-        for (size_t c = 1; c < numInputs; c++) {
-            size_t sz = model.getInputSize(c);
-            std::memcpy(inputs[c], outputs[c], sz * sizeof(float));
-        }
     }
 }
 
@@ -183,14 +197,14 @@ void cleanup(struct audio_ctx *context, void *userData)
 
     if (inputs) {
         for (size_t i = 0; i < numInputs; i++)
-            delete[] inputs[i];
+            OrtModel::freeBuffer(inputs[i]);
         delete[] inputs;
         inputs = nullptr;
     }
     
     if (outputs) {
         for (size_t i = 0; i < numOutputs; i++)
-            delete[] outputs[i];
+            OrtModel::freeBuffer(outputs[i]);
         delete[] outputs;
         outputs = nullptr;
     }
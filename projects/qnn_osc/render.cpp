@@ -22,15 +22,16 @@
 // App parameters set by CLI args
 std::string backendPath;
 std::string systemLibraryPath;
-std::string modelPath;
+std::vector<std::string> modelPaths; // one per block size variant
 int logLevel = 1; // 1=ERROR .. 5=DEBUG
+ar::qnn::ProfilingLevel profilingLevel = ar::qnn::ProfilingLevel::Off;
+std::string profilePath;
 
-std::unique_ptr<ar::qnn::QnnModel> model;
+std::unique_ptr<ar::qnn::QnnModelVariants> model;
 
 // App-specific variables
 // This project assumes a graph with a single model which has only one input and one output,
 // though that isn't always the case.
-const uint32_t g_graphIdx = 0;
 const int g_inputIdx = 0;
 const int g_outputIdx = 0;
 
@@ -60,6 +61,9 @@ void showHelp()
         << "\n"
         << "  --qnn-model        <FILE>   Path to the model: a .dlc container or a\n"
         << "                              .bin context binary. Requires --qnn-system.\n"
+        << "                              Repeat it to give one variant per block size;\n"
+        << "                              the one matching the period is used, or a\n"
+        << "                              smaller one run several times per period.\n"
         << "\n"
         << "  --qnn-system       <FILE>   Path to the QNN System library (libQnnSystem.so),\n"
         << "                              needed when loading a model from a DLC.\n"
@@ -73,6 +77,11 @@ void showHelp()
         << "  --log-level        <1-5>    QNN log level: 1=ERROR, 2=WARN, 3=INFO,\n"
         << "                              4=VERBOSE, 5=DEBUG. Defaults to ERROR.\n"
         << "\n"
+        << "  --profile          <LEVEL>  Profile every inference: basic (whole graph) or\n"
+        << "                              detailed (per op). The report is printed at exit.\n"
+        << "\n"
+        << "  --profile-out      <FILE>   Also save the profile report as CSV.\n"
+        << "\n"
         << "  --project-help              Show this help message.\n"
         << std::endl;
 }
@@ -90,6 +99,8 @@ void processCommandLine(char **argv)
         OPT_LOG_LEVEL,
         OPT_FREQ,
         OPT_AMP,
+        OPT_PROFILE,
+        OPT_PROFILE_OUT,
         OPT_PROJECT_HELP,
     };
 
@@ -102,6 +113,8 @@ void processCommandLine(char **argv)
         {"log-level", OPT_LOG_LEVEL, OPTPARSE_REQUIRED},
         {"freq", OPT_FREQ, OPTPARSE_REQUIRED},
         {"amp", OPT_AMP, OPTPARSE_REQUIRED},
+        {"profile", OPT_PROFILE, OPTPARSE_REQUIRED},
+        {"profile-out", OPT_PROFILE_OUT, OPTPARSE_REQUIRED},
         {"project-help", OPT_PROJECT_HELP, OPTPARSE_NONE},
         {0, 0, OPTPARSE_NONE}};
 
@@ -118,7 +131,7 @@ void processCommandLine(char **argv)
                 fprintf(stderr, "failed parsing model path '%s'\n", opts.optarg);
                 std::exit(EXIT_FAILURE);
             }
-            modelPath = modelPathC;
+            modelPaths.push_back(modelPathC);
             break;
         }
         case OPT_QNN_BACKEND:
@@ -178,6 +191,22 @@ void processCommandLine(char **argv)
             }
             break;
         }
+        case OPT_PROFILE:
+        {
+            if (strcmp(opts.optarg, "basic") == 0)
+                profilingLevel = ar::qnn::ProfilingLevel::Basic;
+            else if (strcmp(opts.optarg, "detailed") == 0)
+                profilingLevel = ar::qnn::ProfilingLevel::Detailed;
+            else
+            {
+                fprintf(stderr, "invalid profiling level '%s' (must be basic or detailed)\n", opts.optarg);
+                std::exit(EXIT_FAILURE);
+            }
+            break;
+        }
+        case OPT_PROFILE_OUT:
+            profilePath = opts.optarg;
+            break;
         case OPT_PROJECT_HELP:
             showHelp();
             std::exit(EXIT_SUCCESS);
@@ -196,49 +225,63 @@ int setup(struct audio_ctx *ctx, void *user_data)
 {
     processCommandLine((char **)user_data);
 
-    if (modelPath.empty() || backendPath.empty() || systemLibraryPath.empty())
+    if (modelPaths.empty() || backendPath.empty() || systemLibraryPath.empty())
     {
         std::cerr << "qnn_osc: --qnn-model, --qnn-backend and --qnn-system are all required\n";
         return EXIT_FAILURE;
     }
 
-    model.reset(new ar::qnn::QnnModel(backendPath, modelPath, systemLibraryPath));
+    model.reset(new ar::qnn::QnnModelVariants(backendPath, modelPaths, systemLibraryPath));
+    model->setProfiling(profilingLevel);
     if (!model->load(logLevel))
     {
         std::cerr << "qnn_osc: failed to load model\n";
         return EXIT_FAILURE;
     }
+    // the variant of the period size, or a smaller one run several times per period
+    if (!model->select(ctx->period_size))
+    {
+        std::cerr << "qnn_osc: no model variant fits a period of " << ctx->period_size << " frames (block sizes: ";
+        for (uint32_t block : model->blockSizes())
+            std::cerr << block << " ";
+        std::cerr << ")\n";
+        return EXIT_FAILURE;
+    }
+    const uint32_t blockSize = model->blockSize();
+    if (blockSize != ctx->period_size)
+        printf("qnn_osc: running the %u-frame model variant %u times per period\n",
+               blockSize, ctx->period_size / blockSize);
 
-    const std::vector<ar::qnn::TensorInfo> &inputs = model->inputs(g_graphIdx);
-    const std::vector<ar::qnn::TensorInfo> &outputs = model->outputs(g_graphIdx);
+    const std::vector<ar::qnn::TensorInfo> &inputs = model->inputs();
+    const std::vector<ar::qnn::TensorInfo> &outputs = model->outputs();
 
     /*
         Make sure the model's IO dimensions are what we expect.
-        This specific project expects a model to take amplitude and phase inputs in batches of
-        period_size (i.e. dimension [period_size, 2]) and output an equal batch of samples
-        (i.e. dimension [period_size, 1]). This will vary depending on the model you use.
+        This specific project expects a model to take amplitude and phase inputs in blocks of
+        frames (i.e. dimension [block size, 2]) and output an equal block of samples
+        (i.e. dimension [block size, 1]). This will vary depending on the model you use.
     */
     const std::vector<uint32_t> &inDims = inputs[g_inputIdx].dims;
     const std::vector<uint32_t> &outDims = outputs[g_outputIdx].dims;
 
-    if (inDims.size() != 2 || inDims[0] != ctx->period_size || inDims[1] != 2)
+    if (inDims.size() != 2 || inDims[0] != blockSize || inDims[1] != 2)
     {
-        std::cerr << "Given model has incorrect input dimensions (expected [" << ctx->period_size << ", 2]): [ ";
+        std::cerr << "Given model has incorrect input dimensions (expected [" << blockSize << ", 2]): [ ";
         for (uint32_t dim : inDims)
             std::cerr << dim << " ";
         std::cerr << "]\n";
         return EXIT_FAILURE;
     }
-    if (outDims.size() != 2 || outDims[0] != ctx->period_size || outDims[1] != 1)
+    if (outDims.size() != 2 || outDims[0] != blockSize || outDims[1] != 1)
     {
-        std::cerr << "Given model has incorrect output dimensions (expected [" << ctx->period_size << ", 1]): [ ";
+        std::cerr << "Given model has incorrect output dimensions (expected [" << blockSize << ", 1]): [ ";
         for (uint32_t dim : outDims)
             std::cerr << dim << " ";
         std::cerr << "]\n";
         return EXIT_FAILURE;
     }
 
-    // Allocate one flat float buffer per input/output tensor.
+    // Allocate one flat float buffer per input/output tensor, a period long.
     g_numInputs = inputs.size();
     g_numOutputs = outputs.size();
     g_inputDataBuffers = (float **)calloc(g_numInputs, sizeof(float *));
@@ -246,12 +289,31 @@ int setup(struct audio_ctx *ctx, void *user_data)
     if (!g_inputDataBuffers || !g_outputDataBuffers)
         return EXIT_FAILURE;
     for (size_t i = 0; i < g_numInputs; ++i)
-        g_inputDataBuffers[i] = (float *)calloc(inputs[i].numElements, sizeof(float));
+        g_inputDataBuffers[i] = (float *)calloc(ctx->period_size * model->inputFrameSize(i), sizeof(float));
     for (size_t i = 0; i < g_numOutputs; ++i)
-        g_outputDataBuffers[i] = (float *)calloc(outputs[i].numElements, sizeof(float));
+        g_outputDataBuffers[i] = (float *)calloc(ctx->period_size * model->outputFrameSize(i), sizeof(float));
 
     phase_inc = 2.0f * M_PI * frequency / (float)(ctx->sample_rate);
 
+    ar::qnn::QnnModel &variant = model->selected();
+
+    // Warm the graph up now, so the first period doesn't pay for the backend's
+    // lazy init, and check the steady-state latency against the period budget
+    // (a block's share of it, when the variant runs several times per period).
+    if (!model->warmup())
+    {
+        std::cerr << "qnn_osc: warm-up failed\n";
+        return EXIT_FAILURE;
+    }
+    const ar::qnn::LatencyStats lat = variant.latencyStats();
+    const float periodBudgetUs = (float)blockSize / (float)ctx->sample_rate * 1e6f;
+    printf("qnn_osc: execute latency (warm-up) min %.0f us | p50 %.0f us | p99 %.0f us | max %.0f us | budget %.0f us\n",
+           lat.minUs, lat.p50Us, lat.p99Us, lat.maxUs, periodBudgetUs);
+    if (lat.p99Us > periodBudgetUs)
+        std::cerr << "qnn_osc: warning: p99 latency exceeds the period budget, expect underruns\n";
+    variant.resetLatencyStats();
+    variant.resetProfile();
+
     return EXIT_SUCCESS;
 }
 
@@ -269,7 +331,7 @@ void render(struct audio_ctx *ctx, void *user_data)
     }
 
     // 2. run the model
-    if (!model->execute(g_graphIdx, g_inputDataBuffers, g_outputDataBuffers))
+    if (!model->execute(g_inputDataBuffers, g_outputDataBuffers))
         return;
 
     // 3. write the model outputs to the audio buffer (same sample to every channel)
@@ -298,6 +360,13 @@ void cleanup(struct audio_ctx *ctx, void *user_data)
         g_outputDataBuffers = nullptr;
     }
 
+    if (model && profilingLevel != ar::qnn::ProfilingLevel::Off)
+    {
+        model->selected().printProfile();
+        if (!profilePath.empty() && model->selected().saveProfile(profilePath))
+            printf("qnn_osc: profile saved to %s\n", profilePath.c_str());
+    }
+
     // releases the backend, context, model and libraries (see QnnModel destructor)
     model.reset();
 }
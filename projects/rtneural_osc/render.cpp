@@ -5,15 +5,18 @@
 
 #include <RTNeural/RTNeural.h>
 #include <string>
+#include <vector>
 #include <math.h>
+#include "RTNeuralBlock.h"
 #include "render.h"
 
+// generated at build time from the project's .json (see the root CMakeLists.txt):
+// the weights are compiled in, so nothing is parsed at startup
+#include "model_weights.h"
+
 float frequency = 440;
 float amplitude = 0.5;
 
-// by default, the model file must be in the same location from where the executable is launched
-std::string modelFilePath = "./1i-512-relu_p=0.5_r=0.5.json";
-
 float phase;
 float inverseSampleRate;
 
@@ -21,10 +24,16 @@ const int hidden_size = 512;
 const int inputSize = 1;
 const int outputSize = 1;
 
-RTNeural::ModelT<float, inputSize, outputSize,
-    RTNeural::DenseT<float, inputSize, hidden_size>,
-    RTNeural::ReLuActivationT<float, hidden_size>,
-    RTNeural::DenseT<float, hidden_size, outputSize> > model;
+static_assert(model_weights::numLayers == 2 &&
+              model_weights::input_layer_in == inputSize && model_weights::input_layer_out == hidden_size &&
+              model_weights::output_layer_in == hidden_size && model_weights::output_layer_out == outputSize,
+              "model_weights.h doesn't match the network topology");
+
+// the whole period goes through the network at once: each dense layer is one
+// matrix-matrix product over all of the period's frames (see RTNeuralBlock.h)
+ar::rtneural::BlockModel<float> model;
+std::vector<float> phases; // model input, one frame per sample of the period
+std::vector<float> outputs;
 
 
 int setup(struct audio_ctx *ctx, void *user_data)
@@ -32,34 +41,33 @@ int setup(struct audio_ctx *ctx, void *user_data)
     inverseSampleRate = 1.0 / (float)(ctx->sample_rate);
     phase = 0.0;
 
-    std::cout << "Loading model from path: " << modelFilePath << std::endl;
-    std::ifstream jsonStream(modelFilePath, std::ifstream::binary);
-    nlohmann::json modelJson;
-    jsonStream >> modelJson;
-
-
-    // Layer indices: 0 = first dense, 1 = ReLU (no weights), 2 = second dense
-    auto& inputLayer = model.get<0>();
-    RTNeural::torch_helpers::loadDense<float>(modelJson, "input_layer.", inputLayer);
+    // Layer indices: 0 = first dense (+ ReLU), 1 = second dense
+    model.addDense(inputSize, hidden_size, ar::rtneural::Activation::ReLu);
+    model.addDense(hidden_size, outputSize);
+    model.setDense(0, model_weights::input_layer_weight, model_weights::input_layer_bias);
+    model.setDense(1, model_weights::output_layer_weight, model_weights::output_layer_bias);
 
-    auto& outputLayer = model.get<2>();
-    RTNeural::torch_helpers::loadDense<float>(modelJson, "output_layer.", outputLayer);
-
-    model.reset();
+    model.prepare(ctx->period_size);
+    phases.assign(ctx->period_size * inputSize, 0.f);
+    outputs.assign(ctx->period_size * outputSize, 0.f);
 
     return 0;
 }
 
 void render(struct audio_ctx *ctx, void *userData)
 {
-    for (unsigned int n=0; n<ctx->period_size; n++) {        
-        float in[1] = {phase};
-        float out = amplitude*model.forward(in);
+    for (unsigned int n=0; n<ctx->period_size; n++) {
+        phases[n] = phase;
 
 		phase += 2.0f * (float)M_PI * frequency * inverseSampleRate;
 		while(phase > 2.0f * (float)M_PI)
 			phase -= 2.0f * (float)M_PI;
-		
+	}
+
+    model.process(phases.data(), outputs.data(), ctx->period_size);
+
+    for (unsigned int n=0; n<ctx->period_size; n++) {
+        float out = amplitude*outputs[n];
         for (unsigned int chn=0; chn<ctx->channels; chn++)
             ctx->audio_buffer[(n * ctx->channels) + chn] = out;
 	}
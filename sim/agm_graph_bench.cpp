@@ -0,0 +1,423 @@
+/*
+ * Copyright 2026 Victor Zappi
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+// agm_graph_bench: runs the engine's mixer setup sequence (hw mixer path, AGM graph
+// build/connect for both directions, module configuration, echo reference, runtime
+// param writes, teardown) against the simulated mixer of mixer_sim.cpp, and reports
+// how many mixer transactions and how much time each step takes. Runs on a plain
+// Linux host: no board, no AGM service. Takes the engine's own command line (graph
+// keys, frontend/backend names, mixer paths...) plus the bench options below.
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cli.h"
+#include "agm_mixer.h"
+#include "hw_mixer.h"
+#include "mixer_sim.h"
+#include "optparse.h"
+#include <kvh2xml.h>  // PER_STREAM_PER_DEVICE_MFC
+
+#define DEFAULT_PLAYBACK_FRONTEND   "PCM100"
+#define DEFAULT_CAPTURE_FRONTEND    "PCM101"
+#define DEFAULT_PLAYBACK_BACKEND    "CODEC_DMA-LPAIF_WSA-RX-0"
+#define DEFAULT_CAPTURE_BACKEND     "CODEC_DMA-LPAIF_VA-TX-0"
+
+#define MAX_MISSING_CTLS 8
+
+#define NUM_TEST_PARAMS 4
+#define TEST_PARAM_ID   0x08001000  // any id: the sim stores whatever it receives
+
+enum bench_step {
+    STEP_HW_MIXER = 0,
+    STEP_GRAPH_SETUP,
+    STEP_CONFIGURE_MODULES,
+    STEP_ECHO_REFERENCE,
+    STEP_SET_PARAMS,
+    STEP_CLEANUP,
+    NUM_STEPS
+};
+
+static const char *step_names[NUM_STEPS] = {
+    "hw mixer path",
+    "graph setup",
+    "configure modules",
+    "echo reference on/off",
+    "set params (batched)",
+    "cleanup",
+};
+
+struct step_stats {
+    uint64_t wall_ns;
+    uint64_t mixer_ns;
+    size_t transactions;
+    size_t ops[MIXER_SIM_NUM_OPS];
+};
+
+struct bench_options {
+    unsigned int iterations;
+    unsigned int transaction_cost_us;
+    unsigned int extra_tags;
+    const char *mixer_paths;
+    const char *backend_conf;
+    const char *missing_ctls[MAX_MISSING_CTLS];
+    unsigned int num_missing_ctls;
+    bool verbose;
+};
+
+static struct step_stats g_stats[NUM_STEPS];
+
+// ---------------------------------------------------------------------------
+// command line
+// ---------------------------------------------------------------------------
+
+static void bench_help(void)
+{
+    fprintf(stderr, "\nagm_graph_bench options (on top of the engine's):\n");
+    fprintf(stderr, "  --iterations <n>            Setup/teardown cycles to average over (default 10)\n");
+    fprintf(stderr, "  --transaction-cost-us <us>  Modelled cost of each mixer round trip (default 0)\n");
+    fprintf(stderr, "  --extra-tags <n>            Pad the getTaggedInfo table with n tags (default 0)\n");
+    fprintf(stderr, "  --mixer-paths <xml>         Hardware mixer paths (default %s)\n", SIM_MIXER_PATHS);
+    fprintf(stderr, "  --backend-conf <xml>        Backend config (default %s)\n", SIM_BACKEND_CONF_FILE);
+    fprintf(stderr, "  --missing-ctl <name>        Control the card doesn't have: a full name, or a suffix\n");
+    fprintf(stderr, "                              like getTaggedInfo for every frontend (repeatable, max %d)\n",
+            MAX_MISSING_CTLS);
+    fprintf(stderr, "  --dump                      Print every transaction of the last iteration\n");
+    fprintf(stderr, "  --bench-help                Show this help message\n\n");
+}
+
+// returns 0 to continue, >0 if help was shown, <0 on error
+static int parse_bench_options(char **argv, struct bench_options *bench)
+{
+    enum {
+        OPT_ITERATIONS = 256,
+        OPT_TRANSACTION_COST,
+        OPT_EXTRA_TAGS,
+        OPT_MIXER_PATHS,
+        OPT_BACKEND_CONF,
+        OPT_MISSING_CTL,
+        OPT_DUMP,
+        OPT_BENCH_HELP,
+    };
+
+    int c;
+    struct optparse opts;
+    struct optparse_long long_options[] = {
+        {"iterations", OPT_ITERATIONS, OPTPARSE_REQUIRED},
+        {"transaction-cost-us", OPT_TRANSACTION_COST, OPTPARSE_REQUIRED},
+        {"extra-tags", OPT_EXTRA_TAGS, OPTPARSE_REQUIRED},
+        {"mixer-paths", OPT_MIXER_PATHS, OPTPARSE_REQUIRED},
+        {"backend-conf", OPT_BACKEND_CONF, OPTPARSE_REQUIRED},
+        {"missing-ctl", OPT_MISSING_CTL, OPTPARSE_REQUIRED},
+        {"dump", OPT_DUMP, OPTPARSE_NONE},
+        {"bench-help", OPT_BENCH_HELP, OPTPARSE_NONE},
+        {0, 0, OPTPARSE_NONE}};
+
+    bench->iterations = 10;
+    bench->transaction_cost_us = 0;
+    bench->extra_tags = 0;
+    bench->mixer_paths = SIM_MIXER_PATHS;
+    bench->backend_conf = SIM_BACKEND_CONF_FILE;
+    bench->num_missing_ctls = 0;
+    bench->verbose = false;
+
+    if (!argv)
+        return 0;
+
+    optparse_init(&opts, argv);
+    while ((c = optparse_long(&opts, long_options, NULL)) != -1) {
+        switch (c) {
+        case OPT_ITERATIONS:
+            bench->iterations = atoi(opts.optarg);
+            if (bench->iterations == 0) {
+                fprintf(stderr, "invalid iteration count '%s'\n", opts.optarg);
+                return -1;
+            }
+            break;
+        case OPT_TRANSACTION_COST:
+            bench->transaction_cost_us = atoi(opts.optarg);
+            break;
+        case OPT_EXTRA_TAGS:
+            bench->extra_tags = atoi(opts.optarg);
+            break;
+        case OPT_MIXER_PATHS:
+            bench->mixer_paths = opts.optarg;
+            break;
+        case OPT_BACKEND_CONF:
+            bench->backend_conf = opts.optarg;
+            break;
+        case OPT_MISSING_CTL:
+            if (bench->num_missing_ctls == MAX_MISSING_CTLS) {
+                fprintf(stderr, "too many --missing-ctl (max %d)\n", MAX_MISSING_CTLS);
+                return -1;
+            }
+            bench->missing_ctls[bench->num_missing_ctls++] = opts.optarg;
+            break;
+        case OPT_DUMP:
+            bench->verbose = true;
+            break;
+        case OPT_BENCH_HELP:
+            bench_help();
+            return 1;
+        default:
+            fprintf(stderr, "%s\n", opts.errmsg);
+            bench_help();
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// the engine resolves these from the card definitions and /proc/asound, neither of
+// which exists off-board
+static int set_default_names(struct pcm_stream *stream, const char *frontend, const char *backend)
+{
+    if (!stream->frontend_name)
+        stream->frontend_name = strdup(frontend);
+    if (!stream->backend_name)
+        stream->backend_name = strdup(backend);
+    return (stream->frontend_name && stream->backend_name) ? 0 : -1;
+}
+
+// ---------------------------------------------------------------------------
+// steps
+// ---------------------------------------------------------------------------
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int run_hw_mixer(struct settings *settings, struct bench_options *bench)
+{
+    if (init_hw_mixer(bench->mixer_paths, settings->physical_card) < 0)
+        return -1;
+    if (set_hw_mixer_path(settings->playback.mixer_path) < 0)
+        return -1;
+    if (settings->full_duplex && set_hw_mixer_path(settings->capture.mixer_path) < 0)
+        return -1;
+    return 0;
+}
+
+static int run_graph_setup(struct settings *settings, struct bench_options *bench)
+{
+    struct pcm_stream *streams[2] = { &settings->playback, &settings->capture };
+    int dirs = settings->full_duplex ? 2 : 1;
+
+    if (init_agm_mixer(settings->virtual_card) < 0)
+        return -1;
+
+    for (int d = 0; d < dirs; d++) {
+        struct pcm_stream *s = streams[d];
+        if (setup_agm_mixer_graph(s->frontend_name, s->backend_name, bench->backend_conf,
+                                  s->stream_kv, s->instance_kv, s->streampp_kv,
+                                  s->devicepp_kv, s->device_kv) < 0)
+            return -1;
+    }
+    // as in the engine, the tag tables are read with the graphs
+    if (load_agm_module_tables() < 0)
+        return -1;
+    return 0;
+}
+
+static int run_configure_modules(struct settings *settings, struct bench_options *bench)
+{
+    (void)bench;
+    struct pcm_stream *pb = &settings->playback;
+
+    if (configure_agm_modules(settings->physical_card, pb->physical_device,
+                              pb->config.period_count, pb->config.period_size) < 0)
+        return -1;
+
+    if (mixer_sim_num_params_set() == 0) {
+        fprintf(stderr, "configure_agm_modules sent no module params\n");
+        return -1;
+    }
+    return 0;
+}
+
+static int run_echo_reference(struct settings *settings, struct bench_options *bench)
+{
+    (void)bench;
+
+    if (!settings->full_duplex)
+        return 0;
+    if (set_agm_ecref_path(settings->capture.frontend_name, settings->playback.backend_name, true))
+        return -1;
+    if (set_agm_ecref_path(settings->capture.frontend_name, settings->playback.backend_name, false))
+        return -1;
+    return 0;
+}
+
+// what agm_param_service does at runtime: several params of one module, one write
+static int run_set_params(struct settings *settings, struct bench_options *bench)
+{
+    (void)bench;
+    struct agm_module_param params[NUM_TEST_PARAMS];
+    uint32_t values[NUM_TEST_PARAMS];
+    uint32_t miid;
+    uint32_t mid;
+
+    if (lookup_agm_module(settings->playback.frontend_name, PER_STREAM_PER_DEVICE_MFC, &miid, &mid) != 0) {
+        fprintf(stderr, "MFC not found in the playback graph\n");
+        return -1;
+    }
+
+    for (int i = 0; i < NUM_TEST_PARAMS; i++) {
+        values[i] = 0x1000 + i;
+        params[i].miid = miid;
+        params[i].param_id = TEST_PARAM_ID + i;
+        params[i].data = &values[i];
+        params[i].size = sizeof(values[i]);
+    }
+    struct agm_param_batch *batch = create_agm_param_batch();
+    int ret = batch ? set_agm_params(batch, settings->playback.frontend_name, params, NUM_TEST_PARAMS) : -ENOMEM;
+    free_agm_param_batch(batch);
+    if (ret < 0)
+        return -1;
+
+    // read back what the card received
+    for (int i = 0; i < NUM_TEST_PARAMS; i++) {
+        uint32_t value = 0;
+        if (mixer_sim_get_param(miid, TEST_PARAM_ID + i, &value, sizeof(value)) < 0 || value != values[i]) {
+            fprintf(stderr, "param 0x%x of module 0x%x not set as expected\n", TEST_PARAM_ID + i, miid);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int run_cleanup(struct settings *settings, struct bench_options *bench)
+{
+    (void)settings;
+    (void)bench;
+
+    cleanup_agm_mixer();
+    cleanup_hw_mixer();
+    return 0;
+}
+
+typedef int (*step_func)(struct settings *, struct bench_options *);
+
+static const step_func steps[NUM_STEPS] = {
+    run_hw_mixer,
+    run_graph_setup,
+    run_configure_modules,
+    run_echo_reference,
+    run_set_params,
+    run_cleanup,
+};
+
+// one full setup/teardown cycle; every step's transactions are added to g_stats
+static int run_iteration(struct settings *settings, struct bench_options *bench)
+{
+    size_t first = 0;
+
+    mixer_sim_reset_log();
+
+    for (int s = 0; s < NUM_STEPS; s++) {
+        uint64_t start = now_ns();
+        int ret = steps[s](settings, bench);
+        g_stats[s].wall_ns += now_ns() - start;
+
+        for (size_t i = first; i < mixer_sim_num_transactions(); i++) {
+            const struct mixer_sim_transaction *t = mixer_sim_transaction_at(i);
+            g_stats[s].mixer_ns += t->duration_ns;
+            g_stats[s].transactions++;
+            g_stats[s].ops[t->op]++;
+        }
+        first = mixer_sim_num_transactions();
+
+        if (ret < 0) {
+            fprintf(stderr, "step '%s' failed\n", step_names[s]);
+            if (s != STEP_CLEANUP)
+                run_cleanup(settings, bench);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void print_report(struct bench_options *bench)
+{
+    size_t total_transactions = 0;
+    uint64_t total_wall = 0;
+    uint64_t total_mixer = 0;
+
+    printf("\n%-24s %8s %11s %11s", "step", "trans.", "wall [us]", "mixer [us]");
+    for (int op = 0; op < MIXER_SIM_NUM_OPS; op++)
+        printf(" %10s", mixer_sim_op_name((enum mixer_sim_op)op));
+    printf("\n");
+
+    for (int s = 0; s < NUM_STEPS; s++) {
+        printf("%-24s %8zu %11.1f %11.1f", step_names[s], g_stats[s].transactions / bench->iterations,
+               g_stats[s].wall_ns / 1000.0 / bench->iterations, g_stats[s].mixer_ns / 1000.0 / bench->iterations);
+        for (int op = 0; op < MIXER_SIM_NUM_OPS; op++)
+            printf(" %10zu", g_stats[s].ops[op] / bench->iterations);
+        printf("\n");
+
+        total_transactions += g_stats[s].transactions;
+        total_wall += g_stats[s].wall_ns;
+        total_mixer += g_stats[s].mixer_ns;
+    }
+
+    printf("%-24s %8zu %11.1f %11.1f\n\n", "total", total_transactions / bench->iterations,
+           total_wall / 1000.0 / bench->iterations, total_mixer / 1000.0 / bench->iterations);
+    printf("averaged over %u iterations, %u us modelled per transaction\n\n",
+           bench->iterations, bench->transaction_cost_us);
+}
+
+// ---------------------------------------------------------------------------
+// entry point
+// ---------------------------------------------------------------------------
+
+int main(int argc, char **argv)
+{
+    struct settings settings;
+    struct bench_options bench;
+    int rc;
+
+    printf("\nAudioReach Audioengine | AGM graph setup bench (simulated mixer)\n\n");
+
+    init_settings(&settings);
+
+    rc = parse_cli(argc, argv, &settings);
+    if (rc == 0)
+        rc = parse_bench_options(settings.user_argv, &bench);
+    if (rc != 0) {
+        cleanup_settings(&settings);
+        return rc > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if (set_default_names(&settings.playback, DEFAULT_PLAYBACK_FRONTEND, DEFAULT_PLAYBACK_BACKEND) < 0 ||
+        set_default_names(&settings.capture, DEFAULT_CAPTURE_FRONTEND, DEFAULT_CAPTURE_BACKEND) < 0) {
+        cleanup_settings(&settings);
+        return EXIT_FAILURE;
+    }
+
+    mixer_sim_set_transaction_cost_us(bench.transaction_cost_us);
+    mixer_sim_add_filler_tags(bench.extra_tags);
+    for (unsigned int i = 0; i < bench.num_missing_ctls; i++)
+        mixer_sim_remove_ctl(bench.missing_ctls[i]);
+
+    for (unsigned int i = 0; i < bench.iterations; i++) {
+        if (run_iteration(&settings, &bench) < 0) {
+            cleanup_settings(&settings);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (bench.verbose)
+        mixer_sim_dump(stdout);
+    print_report(&bench);
+
+    cleanup_settings(&settings);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,453 @@
+/*
+ * Copyright 2026 Victor Zappi
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+// In-memory model of the mixer controls exposed by the AGM virtual card (and of
+// generic hardware mixer controls), implementing the tinyalsa mixer_* functions
+// used by core/. Linked in place of libtinyalsa's mixer; see mixer_sim.h.
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <tinyalsa/asoundlib.h>
+#include <kvh2xml.h>  // PER_STREAM_PER_DEVICE_MFC, DEVICE_HW_ENDPOINT_RX
+
+#include "mixer_sim.h"
+
+#define SIM_MODULE_ID_MFC               0x07001015
+#define SIM_MODULE_ID_CODEC_DMA_SINK    0x07001023
+#define SIM_FILLER_TAG_BASE             0xC1000000
+#define SIM_FILLER_MODULE_ID            0x07000000
+
+#define SIM_TAGGED_INFO_CTL_SIZE        1024  // advertised size of getTaggedInfo, as on target
+#define SIM_BYTES_CTL_SIZE              1024
+
+#define PADDING_8BYTE_ALIGN(x)  ((((x) + 7) & 7) ^ 7)  // as in agm_mixer.cpp
+
+// what the AGM plugin does with a control, from the control name suffix
+enum sim_ctl_kind {
+    SIM_CTL_GENERIC = 0,  // hardware mixer control (enum or int, value just stored)
+    SIM_CTL_METADATA,
+    SIM_CTL_SET_PARAM,
+    SIM_CTL_GET_PARAM,
+    SIM_CTL_TAGGED_INFO,
+    SIM_CTL_MEDIA_CONFIG,  // "rate ch fmt", array of longs
+    SIM_CTL_ENUM,          // control / connect / disconnect / echoReference
+};
+
+// same layout as apm_module_param_data_t in agm_mixer.cpp
+struct sim_param_header {
+    uint32_t module_instance_id;
+    uint32_t param_id;
+    uint32_t param_size;
+    uint32_t error_code;
+};
+
+struct sim_tag {
+    uint32_t tag;
+    uint32_t mid;
+    uint32_t miid;
+};
+
+struct mixer_ctl {
+    std::string name;
+    enum sim_ctl_kind kind;
+    std::vector<std::string> enum_strings;  // every string ever set, index = value
+    int value;
+    std::vector<uint8_t> data;              // last array written
+};
+
+struct mixer {
+    unsigned int card;
+    std::map<std::string, struct mixer_ctl *> ctls;
+};
+
+static std::vector<struct sim_tag> g_tags = {
+    { PER_STREAM_PER_DEVICE_MFC, SIM_MODULE_ID_MFC,            0x4001 },
+    { DEVICE_HW_ENDPOINT_RX,     SIM_MODULE_ID_CODEC_DMA_SINK, 0x4002 },
+};
+static std::map<std::pair<uint32_t, uint32_t>, std::vector<uint8_t>> g_params;
+static size_t g_num_params_set = 0;
+
+static std::vector<struct mixer_sim_transaction> g_log;
+static unsigned int g_cost_us = 0;
+
+// names (or " name" suffixes) mixer_get_ctl_by_name() doesn't find
+static std::vector<std::string> g_removed_ctls;
+
+// ---------------------------------------------------------------------------
+// transaction recording
+// ---------------------------------------------------------------------------
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t begin_transaction(void)
+{
+    return now_ns();
+}
+
+static void end_transaction(uint64_t start, enum mixer_sim_op op, const struct mixer_ctl *ctl, size_t bytes)
+{
+    // busy-wait rather than sleep: costs are typically tens of us, below what a
+    // sleep can resolve reliably
+    if (g_cost_us) {
+        uint64_t until = start + (uint64_t)g_cost_us * 1000ULL;
+        while (now_ns() < until)
+            ;
+    }
+
+    struct mixer_sim_transaction t;
+    t.op = op;
+    strncpy(t.ctl_name, ctl->name.c_str(), sizeof(t.ctl_name) - 1);
+    t.ctl_name[sizeof(t.ctl_name) - 1] = '\0';
+    t.bytes = bytes;
+    t.start_ns = start;
+    t.duration_ns = now_ns() - start;
+    g_log.push_back(t);
+}
+
+// ---------------------------------------------------------------------------
+// control models
+// ---------------------------------------------------------------------------
+
+static bool ends_with(const std::string &s, const char *suffix)
+{
+    size_t n = strlen(suffix);
+    return s.size() > n && s.compare(s.size() - n, n, suffix) == 0 && s[s.size() - n - 1] == ' ';
+}
+
+static enum sim_ctl_kind ctl_kind_from_name(const std::string &name)
+{
+    if (ends_with(name, "metadata"))
+        return SIM_CTL_METADATA;
+    if (ends_with(name, "setParam"))
+        return SIM_CTL_SET_PARAM;
+    if (ends_with(name, "getParam"))
+        return SIM_CTL_GET_PARAM;
+    if (ends_with(name, "getTaggedInfo"))
+        return SIM_CTL_TAGGED_INFO;
+    if (ends_with(name, "rate ch fmt"))
+        return SIM_CTL_MEDIA_CONFIG;
+    if (ends_with(name, "control") || ends_with(name, "connect") ||
+        ends_with(name, "disconnect") || ends_with(name, "echoReference"))
+        return SIM_CTL_ENUM;
+    return SIM_CTL_GENERIC;
+}
+
+// store every module param block of a (possibly batched) setParam payload
+static int sim_set_params(const uint8_t *payload, size_t size)
+{
+    size_t offset = 0;
+
+    while (offset + sizeof(struct sim_param_header) <= size) {
+        const struct sim_param_header *h = (const struct sim_param_header *)(payload + offset);
+        size_t block = sizeof(struct sim_param_header) + h->param_size;
+        if (offset + block > size)
+            return -EINVAL;
+
+        const uint8_t *data = payload + offset + sizeof(struct sim_param_header);
+        g_params[std::make_pair(h->module_instance_id, h->param_id)].assign(data, data + h->param_size);
+        g_num_params_set++;
+
+        offset += block + PADDING_8BYTE_ALIGN(block);
+    }
+    return 0;
+}
+
+// getTaggedInfo reply: gsl_tag_module_info with one module per tag, cut at count
+// bytes like a TLV read into a short buffer
+static void sim_get_tagged_info(uint8_t *out, size_t count)
+{
+    std::vector<uint8_t> table;
+    uint32_t num_tags = (uint32_t)g_tags.size();
+
+    table.insert(table.end(), (uint8_t *)&num_tags, (uint8_t *)&num_tags + sizeof(num_tags));
+    for (const struct sim_tag &t : g_tags) {
+        uint32_t entry[4] = { t.tag, 1, t.mid, t.miid };  // tag_id, num_modules, module_entry[0]
+        table.insert(table.end(), (uint8_t *)entry, (uint8_t *)entry + sizeof(entry));
+    }
+
+    memset(out, 0, count);
+    memcpy(out, table.data(), table.size() < count ? table.size() : count);
+}
+
+// ---------------------------------------------------------------------------
+// tinyalsa mixer API
+// ---------------------------------------------------------------------------
+
+struct mixer *mixer_open(unsigned int card)
+{
+    struct mixer *m = new mixer();
+    m->card = card;
+    return m;
+}
+
+void mixer_close(struct mixer *mixer)
+{
+    if (!mixer)
+        return;
+    for (auto &c : mixer->ctls)
+        delete c.second;
+    delete mixer;
+}
+
+struct mixer_ctl *mixer_get_ctl_by_name(struct mixer *mixer, const char *name)
+{
+    if (!mixer || !name)
+        return NULL;
+
+    // controls come into existence on first lookup: the AGM plugin exposes the
+    // same set for every frontend/backend, and any hardware control is accepted
+    auto it = mixer->ctls.find(name);
+    if (it != mixer->ctls.end())
+        return it->second;
+
+    std::string ctl_name = name;
+    for (const std::string &removed : g_removed_ctls)
+        if (ctl_name == removed || ends_with(ctl_name, removed.c_str()))
+            return NULL;
+
+    struct mixer_ctl *ctl = new mixer_ctl();
+    ctl->name = name;
+    ctl->kind = ctl_kind_from_name(ctl->name);
+    ctl->value = 0;
+    mixer->ctls[ctl->name] = ctl;
+    return ctl;
+}
+
+enum mixer_ctl_type mixer_ctl_get_type(const struct mixer_ctl *ctl)
+{
+    switch (ctl->kind) {
+    case SIM_CTL_METADATA:
+    case SIM_CTL_SET_PARAM:
+    case SIM_CTL_GET_PARAM:
+    case SIM_CTL_TAGGED_INFO:
+        return MIXER_CTL_TYPE_BYTE;
+    case SIM_CTL_MEDIA_CONFIG:
+        return MIXER_CTL_TYPE_INT;
+    default:
+        return MIXER_CTL_TYPE_ENUM;
+    }
+}
+
+unsigned int mixer_ctl_get_num_values(const struct mixer_ctl *ctl)
+{
+    switch (ctl->kind) {
+    case SIM_CTL_TAGGED_INFO:
+        return SIM_TAGGED_INFO_CTL_SIZE;
+    case SIM_CTL_METADATA:
+    case SIM_CTL_SET_PARAM:
+    case SIM_CTL_GET_PARAM:
+        return SIM_BYTES_CTL_SIZE;
+    case SIM_CTL_MEDIA_CONFIG:
+        return 4;
+    default:
+        return 1;
+    }
+}
+
+int mixer_ctl_get_value(const struct mixer_ctl *ctl, unsigned int id)
+{
+    uint64_t start = begin_transaction();
+    int value = id == 0 ? ctl->value : 0;
+    end_transaction(start, MIXER_SIM_GET_VALUE, ctl, 0);
+    return value;
+}
+
+int mixer_ctl_set_value(struct mixer_ctl *ctl, unsigned int id, int value)
+{
+    uint64_t start = begin_transaction();
+    if (id == 0)
+        ctl->value = value;
+    end_transaction(start, MIXER_SIM_SET_VALUE, ctl, 0);
+    return 0;
+}
+
+const char *mixer_ctl_get_enum_string(const struct mixer_ctl *ctl, unsigned int enum_id)
+{
+    if (enum_id >= ctl->enum_strings.size())
+        return NULL;
+    return ctl->enum_strings[enum_id].c_str();
+}
+
+int mixer_ctl_set_enum_by_string(struct mixer_ctl *ctl, const char *string)
+{
+    uint64_t start = begin_transaction();
+    size_t i;
+
+    for (i = 0; i < ctl->enum_strings.size(); i++)
+        if (ctl->enum_strings[i] == string)
+            break;
+    if (i == ctl->enum_strings.size())
+        ctl->enum_strings.push_back(string);
+    ctl->value = (int)i;
+
+    end_transaction(start, MIXER_SIM_SET_ENUM, ctl, 0);
+    return 0;
+}
+
+int mixer_ctl_set_array(struct mixer_ctl *ctl, const void *array, size_t count)
+{
+    // like tinyalsa: rejected before any round trip to the card
+    if (count > mixer_ctl_get_num_values(ctl)) {
+        errno = EINVAL;
+        return -EINVAL;
+    }
+
+    uint64_t start = begin_transaction();
+    size_t bytes = ctl->kind == SIM_CTL_MEDIA_CONFIG ? count * sizeof(long) : count;
+    int ret = 0;
+
+    ctl->data.assign((const uint8_t *)array, (const uint8_t *)array + bytes);
+    if (ctl->kind == SIM_CTL_SET_PARAM)
+        ret = sim_set_params((const uint8_t *)array, bytes);
+
+    end_transaction(start, MIXER_SIM_SET_ARRAY, ctl, bytes);
+    return ret;
+}
+
+int mixer_ctl_get_array(const struct mixer_ctl *ctl, void *array, size_t count)
+{
+    // like tinyalsa: rejected before any round trip to the card
+    if (count > mixer_ctl_get_num_values(ctl)) {
+        errno = EINVAL;
+        return -EINVAL;
+    }
+
+    uint64_t start = begin_transaction();
+    size_t bytes = ctl->kind == SIM_CTL_MEDIA_CONFIG ? count * sizeof(long) : count;
+
+    if (ctl->kind == SIM_CTL_TAGGED_INFO) {
+        sim_get_tagged_info((uint8_t *)array, bytes);
+    } else if (ctl->kind == SIM_CTL_GET_PARAM && ctl->data.size() >= sizeof(struct sim_param_header)) {
+        // reply to the query header written just before: header + stored value
+        struct sim_param_header h;
+        memcpy(&h, ctl->data.data(), sizeof(h));
+        memset(array, 0, bytes);
+        auto it = g_params.find(std::make_pair(h.module_instance_id, h.param_id));
+        if (it == g_params.end()) {
+            h.error_code = (uint32_t)-ENOENT;
+        } else {
+            size_t n = it->second.size();
+            if (n > bytes - sizeof(h))
+                n = bytes - sizeof(h);
+            memcpy((uint8_t *)array + sizeof(h), it->second.data(), n);
+            h.param_size = (uint32_t)n;
+        }
+        memcpy(array, &h, sizeof(h) < bytes ? sizeof(h) : bytes);
+    } else {
+        memset(array, 0, bytes);
+        memcpy(array, ctl->data.data(), ctl->data.size() < bytes ? ctl->data.size() : bytes);
+    }
+
+    end_transaction(start, MIXER_SIM_GET_ARRAY, ctl, bytes);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// sim configuration & log access
+// ---------------------------------------------------------------------------
+
+void mixer_sim_add_tag(uint32_t tag, uint32_t mid, uint32_t miid)
+{
+    g_tags.push_back({ tag, mid, miid });
+}
+
+void mixer_sim_add_filler_tags(unsigned int n)
+{
+    for (unsigned int i = 0; i < n; i++)
+        g_tags.push_back({ SIM_FILLER_TAG_BASE + i, SIM_FILLER_MODULE_ID + i, 0x8000 + i });
+}
+
+void mixer_sim_set_transaction_cost_us(unsigned int us)
+{
+    g_cost_us = us;
+}
+
+void mixer_sim_remove_ctl(const char *name)
+{
+    g_removed_ctls.push_back(name);
+}
+
+void mixer_sim_reset_log(void)
+{
+    g_log.clear();
+    g_params.clear();
+    g_num_params_set = 0;
+}
+
+size_t mixer_sim_num_transactions(void)
+{
+    return g_log.size();
+}
+
+size_t mixer_sim_num_transactions_of(enum mixer_sim_op op)
+{
+    size_t n = 0;
+    for (const struct mixer_sim_transaction &t : g_log)
+        if (t.op == op)
+            n++;
+    return n;
+}
+
+uint64_t mixer_sim_total_ns(void)
+{
+    uint64_t total = 0;
+    for (const struct mixer_sim_transaction &t : g_log)
+        total += t.duration_ns;
+    return total;
+}
+
+const struct mixer_sim_transaction *mixer_sim_transaction_at(size_t i)
+{
+    return i < g_log.size() ? &g_log[i] : NULL;
+}
+
+size_t mixer_sim_num_params_set(void)
+{
+    return g_num_params_set;
+}
+
+int mixer_sim_get_param(uint32_t miid, uint32_t param_id, void *data, size_t size)
+{
+    auto it = g_params.find(std::make_pair(miid, param_id));
+    if (it == g_params.end())
+        return -ENOENT;
+    memcpy(data, it->second.data(), it->second.size() < size ? it->second.size() : size);
+    return 0;
+}
+
+const char *mixer_sim_op_name(enum mixer_sim_op op)
+{
+    switch (op) {
+    case MIXER_SIM_SET_ARRAY: return "set_array";
+    case MIXER_SIM_GET_ARRAY: return "get_array";
+    case MIXER_SIM_SET_ENUM:  return "set_enum";
+    case MIXER_SIM_GET_VALUE: return "get_value";
+    case MIXER_SIM_SET_VALUE: return "set_value";
+    default:                  return "unknown";
+    }
+}
+
+void mixer_sim_dump(FILE *f)
+{
+    uint64_t t0 = g_log.empty() ? 0 : g_log[0].start_ns;
+
+    for (size_t i = 0; i < g_log.size(); i++) {
+        const struct mixer_sim_transaction &t = g_log[i];
+        fprintf(f, "%4zu  +%9.1f us  %-9s  %-48s  %6zu B  %7.1f us\n", i,
+                (t.start_ns - t0) / 1000.0, mixer_sim_op_name(t.op), t.ctl_name, t.bytes,
+                t.duration_ns / 1000.0);
+    }
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright 2026 Victor Zappi
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+// mixer_sim.h
+// link-time stand-in for the tinyalsa mixer_* API, so agm_mixer.cpp and hw_mixer.cpp
+// can run on a plain Linux host. AGM virtual-card controls (metadata, control,
+// connect/disconnect, setParam, getParam, getTaggedInfo, echoReference, rate ch fmt)
+// are modelled in memory; any other control name is accepted as a generic enum, so
+// hardware mixer paths apply too, unless removed with mixer_sim_remove_ctl(). Array
+// reads/writes larger than the control's value count fail with -EINVAL, as in
+// tinyalsa. Every control read/write is recorded with its timing, to count and
+// time the mixer round trips of a graph setup.
+#ifndef __MIXER_SIM_H__
+#define __MIXER_SIM_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+enum mixer_sim_op {
+    MIXER_SIM_SET_ARRAY = 0,
+    MIXER_SIM_GET_ARRAY,
+    MIXER_SIM_SET_ENUM,
+    MIXER_SIM_GET_VALUE,
+    MIXER_SIM_SET_VALUE,
+    MIXER_SIM_NUM_OPS
+};
+
+// one control read/write, i.e. one user/kernel round trip on a real card
+struct mixer_sim_transaction {
+    enum mixer_sim_op op;
+    char ctl_name[96];
+    size_t bytes;          // payload size for array ops, 0 otherwise
+    uint64_t start_ns;     // CLOCK_MONOTONIC
+    uint64_t duration_ns;  // includes the modelled cost (mixer_sim_set_transaction_cost_us)
+};
+
+// module reported by getTaggedInfo for tag; the defaults describe a minimal
+// playback graph (PSPD MFC + Codec DMA sink)
+void mixer_sim_add_tag(uint32_t tag, uint32_t mid, uint32_t miid);
+// pad the tag table with n dummy tags, to model large graphs
+void mixer_sim_add_filler_tags(unsigned int n);
+// busy-wait this long in every transaction, to model the kernel/DSP round trip
+void mixer_sim_set_transaction_cost_us(unsigned int us);
+// make mixer_get_ctl_by_name() fail (NULL) for the control called name, or for
+// every control whose name ends in " name" (e.g. "getTaggedInfo" for all
+// frontends), to exercise the engine's missing-control paths
+void mixer_sim_remove_ctl(const char *name);
+
+// transaction log; reset also clears the params stored by setParam
+void mixer_sim_reset_log(void);
+size_t mixer_sim_num_transactions(void);
+size_t mixer_sim_num_transactions_of(enum mixer_sim_op op);
+uint64_t mixer_sim_total_ns(void);
+const struct mixer_sim_transaction *mixer_sim_transaction_at(size_t i);
+void mixer_sim_dump(FILE *f);
+
+// number of module param blocks received through setParam (a batched write counts
+// each block) and the last value stored for one of them
+size_t mixer_sim_num_params_set(void);
+int mixer_sim_get_param(uint32_t miid, uint32_t param_id, void *data, size_t size);
+
+const char *mixer_sim_op_name(enum mixer_sim_op op);
+
+#endif // __MIXER_SIM_H__